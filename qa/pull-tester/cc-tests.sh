@@ -21,6 +21,7 @@ testScripts=(
     'cryptoconditions_heir.py'
     # TODO: cant reconnect nodes back in channels test because of crash (seems regtest only specific)
     'cryptoconditions_channels.py'
+    'kv_expiry.py'
 );
 
 extArg="-extended"
@@ -75,6 +75,8 @@ testScripts=(
     'rewind_index.py'
     'p2p_txexpiry_dos.py'
     'p2p_node_bloom.py'
+    'p2p_compactblocks.py'
+    'rpc_concurrent_reads.py'
     'regtest_signrawtransaction.py'
     'finalsaplingroot.py'
 );
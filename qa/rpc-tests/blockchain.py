@@ -31,7 +31,8 @@ class BlockchainTest(BitcoinTestFramework):
         initialize_chain(self.options.tmpdir)
 
     def setup_network(self, split=False):
-        self.nodes = start_nodes(2, self.options.tmpdir)
+        # node 1 has no UTXO stats index and scans its coins database
+        self.nodes = start_nodes(2, self.options.tmpdir, [['-utxostatsindex'], []])
         connect_nodes_bi(self.nodes, 0, 1)
         self.is_network_split = False
         self.sync_all()
@@ -48,6 +49,28 @@ class BlockchainTest(BitcoinTestFramework):
         assert_equal(len(res[u'bestblock']), 64)
         assert_equal(len(res[u'hash_serialized']), 64)
 
+        # The indexed statistics agree with the full scan and with a node
+        # that computes them from its coins database
+        indexed = node.gettxoutsetinfo('muhash')
+        for key in ['total_amount', 'transactions', 'height', 'txouts', 'bestblock', 'muhash']:
+            assert_equal(indexed[key], res[key])
+        assert_equal(len(indexed[u'muhash']), 64)
+        assert('muhash' not in self.nodes[1].gettxoutsetinfo())
+        scanned = self.nodes[1].gettxoutsetinfo('muhash')
+        assert_equal(scanned, indexed)
+
+        # ... and follow the tip, including across a spend and a reorg
+        node.sendtoaddress(node.getnewaddress(), decimal.Decimal('1.0'))
+        node.generate(1)
+        self.sync_all()
+        assert_equal(node.gettxoutsetinfo('muhash'), self.nodes[1].gettxoutsetinfo('muhash'))
+
+        tip = node.getbestblockhash()
+        node.invalidateblock(tip)
+        assert_equal(node.gettxoutsetinfo('muhash'), indexed)
+        node.reconsiderblock(tip)
+        assert_equal(node.gettxoutsetinfo('muhash'), self.nodes[1].gettxoutsetinfo('muhash'))
+
 
 if __name__ == '__main__':
     BlockchainTest().main()
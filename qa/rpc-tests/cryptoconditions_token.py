@@ -125,6 +125,11 @@ class CryptoconditionsTokenTest(CryptoconditionsTestFramework):
         order = result[0]
         assert order, "found order"
 
+        # paging through the orders
+        assert_equal(rpc.tokenorders(tokenid, "1"), [order])
+        assert_equal(rpc.tokenorders(tokenid, "1", "1"), [])
+        assert(order in rpc.tokenorders(""))
+
         # invalid ask fillunits
         result = rpc.tokenfillask(tokenid, tokenaskid, "0")
         assert_error(result)
@@ -242,6 +247,25 @@ class CryptoconditionsTokenTest(CryptoconditionsTestFramework):
         result = rpc.tokenbalance(tokenid,randompubkey)
         assert_equal(result["balance"], 1)
 
+        # node0 answers from the token index, node1 scans the token cc addresses
+        self.sync_all()
+        for pubkey in [self.pubkey, randompubkey]:
+            assert_equal(rpc.tokenbalance(tokenid, pubkey)['balance'], rpc1.tokenbalance(tokenid, pubkey)['balance'])
+        result = rpc.tokeninfo(tokenid)
+        assert_equal(result['supply'], rpc1.tokeninfo(tokenid)['supply'])
+        assert_equal(result['holders'], 2)
+        assert(tokenid in rpc.tokenlist())
+        assert(tokenid in rpc1.tokenlist())
+
+        # failed CC builds leave the normal inputs they picked free: node1 owns no
+        # DUKE tokens, so each transfer fails after it has added a txfee input
+        for i in range(2):
+            result = rpc1.tokentransfer(tokenid, randompubkey, "1")
+            assert_error(result)
+        result = rpc1.tokencreate("ONE", "0.1", "created right after failed builds")
+        assert_success(result)
+        self.send_and_mine(result['hex'], rpc1)
+
     def run_test(self):
         print("Mining blocks...")
         rpc = self.nodes[0]
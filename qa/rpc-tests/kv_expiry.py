@@ -0,0 +1,83 @@
+#!/usr/bin/env python2
+# Copyright (c) 2019 SuperNET developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test that KV entries stop being returned by kvsearch and kvlist once
+# their expiry height has passed, that live entries are kept, and that
+# updates still in the mempool are returned before they are mined.
+#
+
+from test_framework.test_framework import CryptoconditionsTestFramework
+from test_framework.util import assert_equal
+
+
+class KVExpiryTest(CryptoconditionsTestFramework):
+
+    def kvlist_keys(self, rpc, prefix=''):
+        return [item['key'] for item in rpc.kvlist(prefix)]
+
+    def run_test(self):
+        print("Mining blocks...")
+        rpc = self.nodes[0]
+        rpc1 = self.nodes[1]
+        rpc.generate(101)
+        self.sync_all()
+        rpc.importprivkey(self.privkey)
+
+        # a new key is stored with flags 0, so for one day whatever the days argument
+        height = rpc.getblockcount()
+        short = rpc.kvupdate("kvtest_short", "gone after a day", "1")
+        assert_equal(short['key'], "kvtest_short")
+        self.sync_all()
+
+        # both nodes see the update while it waits in their mempools
+        for node in [rpc, rpc1]:
+            assert_equal(node.kvsearch("kvtest_short")['value'], "gone after a day")
+            assert_equal(node.kvsearch("kvtest_short")['height'], height)
+            assert_equal(self.kvlist_keys(node, "kvtest_"), ["kvtest_short"])
+        rpc.generate(1)
+        self.sync_all()
+        assert_equal(rpc.getrawmempool(), [])
+        assert_equal(rpc1.kvsearch("kvtest_short")['value'], "gone after a day")
+
+        # a pending update replaces the mined value until it is mined itself
+        rpc.kvupdate("kvtest_short", "updated in the mempool", "1")
+        self.sync_all()
+        for node in [rpc, rpc1]:
+            assert_equal(node.kvsearch("kvtest_short")['value'], "updated in the mempool")
+            assert_equal(node.kvsearch("kvtest_short")['height'], height + 1)
+        rpc.generate(1)
+        self.sync_all()
+        assert_equal(rpc1.kvsearch("kvtest_short")['value'], "updated in the mempool")
+
+        rpc.generate(10)
+        rpc.kvupdate("kvtest_long", "set ten blocks later", "1")
+        rpc.generate(1)
+        self.sync_all()
+
+        for node in [rpc, rpc1]:
+            assert_equal(self.kvlist_keys(node, "kvtest_"), ["kvtest_long", "kvtest_short"])
+        assert_equal(self.kvlist_keys(rpc, "kvtest_l"), ["kvtest_long"])
+
+        entry = rpc.kvlist("kvtest_short")[0]
+        assert_equal(entry['value'], "updated in the mempool")
+        assert_equal(entry['height'], height + 1)
+        assert_equal(entry['expiration'], entry['height'] + 1440)
+
+        # still live at its expiry height
+        rpc.generate(entry['expiration'] - rpc.getblockcount())
+        self.sync_all()
+        assert_equal(self.kvlist_keys(rpc1, "kvtest_"), ["kvtest_long", "kvtest_short"])
+
+        # and gone one block later, node1 never searched for it
+        rpc.generate(1)
+        self.sync_all()
+        for node in [rpc1, rpc]:
+            assert_equal(self.kvlist_keys(node, "kvtest_"), ["kvtest_long"])
+            assert_equal(node.kvsearch("kvtest_short")['error'], "cant find key")
+            assert_equal(node.kvsearch("kvtest_long")['value'], "set ten blocks later")
+
+if __name__ == '__main__':
+    KVExpiryTest().main()
@@ -0,0 +1,141 @@
+#!/usr/bin/env python2
+# Copyright (c) 2019 The SuperNET developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test compact block relay (sendcmpct/cmpctblock/getblocktxn/blocktxn).
+#
+# Nodes are connected in a line 0 <-> 1 <-> 2. Blocks mined on node 0 are
+# reconstructed by the other nodes from their mempools, and transactions
+# the receiver never saw are fetched with getblocktxn. The per command
+# message counts of getpeerinfo show which messages were exchanged.
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    connect_nodes_bi,
+    start_nodes,
+    sync_blocks,
+    sync_mempools,
+    wait_and_assert_operationid_status,
+)
+
+from decimal import Decimal
+import time
+
+
+class CompactBlocksTest(BitcoinTestFramework):
+
+    def setup_nodes(self):
+        return start_nodes(3, self.options.tmpdir, [[
+            '-nuparams=5ba81b19:201', # Overwinter
+            '-nuparams=76b809bb:201', # Sapling
+            '-debug=cmpctblock',
+        ]] * 3)
+
+    def setup_network(self, split=False):
+        self.nodes = self.setup_nodes()
+        connect_nodes_bi(self.nodes, 0, 1)
+        connect_nodes_bi(self.nodes, 1, 2)
+        self.is_network_split = False
+        self.sync_all()
+
+    def check_block_relayed(self, blockhash, txids):
+        sync_blocks(self.nodes)
+        for node in self.nodes:
+            assert_equal(node.getbestblockhash(), blockhash)
+            block = node.getblock(blockhash)
+            for txid in txids:
+                assert(txid in block['tx'])
+            assert_equal(node.getrawmempool(), [])
+
+    def msgcount(self, node, command):
+        return sum(peer['msgproctime'].get(command, {'count': 0})['count'] for peer in node.getpeerinfo())
+
+    def msgcounts(self, command):
+        return [self.msgcount(node, command) for node in self.nodes]
+
+    def disconnect_nodes_0_1(self):
+        peers = self.nodes[0].getpeerinfo()
+        remaining = len(self.nodes[1].getpeerinfo()) - len(peers)
+        for peer in peers:
+            self.nodes[0].disconnectnode(peer['addr'])
+        while len(self.nodes[0].getpeerinfo()) > 0 or len(self.nodes[1].getpeerinfo()) > remaining:
+            time.sleep(0.1)
+
+    def reconnect_nodes_0_1(self):
+        connect_nodes_bi(self.nodes, 0, 1)
+        while not all(peer.get('compactblocks') for peer in self.nodes[0].getpeerinfo() + self.nodes[1].getpeerinfo()):
+            time.sleep(0.1)
+
+    def run_test(self):
+        assert_equal(self.nodes[0].getblockcount(), 200)
+        self.nodes[0].generate(2)
+        self.sync_all()
+
+        # Every peer negotiated compact blocks during the handshake
+        for node in self.nodes:
+            for peer in node.getpeerinfo():
+                assert_equal(peer['compactblocks'], True)
+
+        # A block made only of transactions every node already has
+        taddr1 = self.nodes[1].getnewaddress()
+        taddr2 = self.nodes[2].getnewaddress()
+        txids = []
+        for i in range(5):
+            txids.append(self.nodes[0].sendtoaddress(taddr1, Decimal('1.5')))
+            txids.append(self.nodes[0].sendtoaddress(taddr2, Decimal('2.5')))
+        sync_mempools(self.nodes)
+        cmpctblock = self.msgcounts('cmpctblock')
+        block = self.msgcounts('block')
+        getblocktxn = self.msgcounts('getblocktxn')
+        blockhash = self.nodes[0].generate(1)[0]
+        self.check_block_relayed(blockhash, txids)
+
+        # ... is relayed as a compact block and rebuilt without fetching anything
+        cmpctblock_after = self.msgcounts('cmpctblock')
+        assert(cmpctblock_after[1] > cmpctblock[1])
+        assert(cmpctblock_after[2] > cmpctblock[2])
+        assert_equal(self.msgcounts('block'), block)
+        assert_equal(self.msgcounts('getblocktxn'), getblocktxn)
+
+        # Transactions broadcast by node 0 while node 1 is disconnected never
+        # reach the other nodes, so they have to fetch them through
+        # getblocktxn/blocktxn. Counts restart with the new connections.
+        self.disconnect_nodes_0_1()
+        rawtxs = []
+        for i in range(3):
+            rawtxs.append(self.nodes[0].createrawtransaction([], {taddr2: Decimal('0.5')}))
+        txids = []
+        for raw in rawtxs:
+            funded = self.nodes[0].fundrawtransaction(raw)
+            signed = self.nodes[0].signrawtransaction(funded['hex'])
+            assert_equal(signed['complete'], True)
+            txids.append(self.nodes[0].sendrawtransaction(signed['hex'], False))
+        self.reconnect_nodes_0_1()
+        assert_equal(self.nodes[1].getrawmempool(), [])
+        block = self.msgcounts('block')
+        blocktxn = self.msgcounts('blocktxn')
+        blockhash = self.nodes[0].generate(1)[0]
+        self.check_block_relayed(blockhash, txids)
+
+        blocktxn_after = self.msgcounts('blocktxn')
+        assert(self.msgcount(self.nodes[0], 'getblocktxn') > 0)
+        assert(blocktxn_after[1] > blocktxn[1])
+        assert(blocktxn_after[2] > blocktxn[2])
+        assert_equal(self.msgcounts('block'), block)
+
+        # Shielded transactions are identified by txid like any other
+        zaddr1 = self.nodes[1].z_getnewaddress('sapling')
+        opid = self.nodes[1].z_sendmany(taddr1, [{'address': zaddr1, 'amount': Decimal('5')}], 1, 0)
+        shieldtxid = wait_and_assert_operationid_status(self.nodes[1], opid)
+        sync_mempools(self.nodes)
+        blockhash = self.nodes[2].generate(1)[0]
+        self.check_block_relayed(blockhash, [shieldtxid])
+        assert_equal(self.nodes[1].z_getbalance(zaddr1), Decimal('5'))
+
+
+if __name__ == '__main__':
+    CompactBlocksTest().main()
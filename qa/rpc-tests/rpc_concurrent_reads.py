@@ -0,0 +1,82 @@
+#!/usr/bin/env python2
+# Copyright (c) 2019 The SuperNET developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Stress read RPCs while blocks are being connected.
+#
+# gettxoutsetinfo scans a snapshot of the coin database and getrawtransaction
+# reads the tx index without cs_main, so both must keep answering with
+# consistent results while another connection mines and imports blocks.
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import AuthServiceProxy
+from test_framework.util import assert_equal, start_nodes
+
+import threading
+import time
+
+
+class MinerThread(threading.Thread):
+    def __init__(self, node, nblocks):
+        threading.Thread.__init__(self)
+        # we can't use the same connection from two threads
+        self.node = AuthServiceProxy(node.url, timeout=600)
+        self.nblocks = nblocks
+        self.txids = []
+
+    def run(self):
+        addr = self.node.getnewaddress()
+        for i in range(self.nblocks):
+            self.txids.append(self.node.sendtoaddress(addr, 1))
+            self.node.generate(1)
+
+
+class ConcurrentReadsTest(BitcoinTestFramework):
+
+    def setup_nodes(self):
+        return start_nodes(1, self.options.tmpdir, [['-txindex']])
+
+    def setup_network(self, split=False):
+        self.nodes = self.setup_nodes()
+        self.is_network_split = False
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(101)
+        txids = [node.sendtoaddress(node.getnewaddress(), 1) for i in range(5)]
+        node.generate(1)
+
+        miner = MinerThread(node, 25)
+        miner.start()
+
+        latencies = []
+        while miner.is_alive():
+            start = time.time()
+            stats = node.gettxoutsetinfo()
+            latencies.append(time.time() - start)
+            # The statistics always describe exactly one block
+            header = node.getblockheader(stats['bestblock'])
+            assert_equal(stats['height'], header['height'])
+
+            for txid in txids:
+                start = time.time()
+                assert_equal(node.getrawtransaction(txid), node.getrawtransaction(txid, 0))
+                latencies.append(time.time() - start)
+        miner.join()
+
+        print "%d reads during block import, max latency %.3fs, average %.3fs" % (
+            len(latencies), max(latencies), sum(latencies) / len(latencies))
+
+        # Once mining stops the snapshot view matches the final tip
+        stats = node.gettxoutsetinfo()
+        assert_equal(stats['bestblock'], node.getbestblockhash())
+        assert_equal(stats['height'], node.getblockcount())
+        for txid in miner.txids:
+            assert_equal(node.getrawtransaction(txid, 1)['txid'], txid)
+
+
+if __name__ == '__main__':
+    ConcurrentReadsTest().main()
@@ -209,6 +209,7 @@ class CryptoconditionsTestFramework(BitcoinTestFramework):
                     '-regtest',
                     '-addressindex=1',
                     '-spentindex=1',
+                    '-tokenindex=1',
                     '-ac_supply=5555555',
                     '-ac_reward=10000000000000',
                     '-pubkey=' + self.pubkey,
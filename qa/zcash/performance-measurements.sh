@@ -203,6 +203,9 @@ case "$1" in
             incnotewitnesses)
                 zcash_rpc zcbenchmark incnotewitnesses 100 "${@:3}"
                 ;;
+            incsaplingnotewitnesses)
+                zcash_rpc zcbenchmark incsaplingnotewitnesses 10 "${@:3}"
+                ;;
             connectblockslow)
                 extract_benchmark_data
                 zcash_rpc zcbenchmark connectblockslow 10
@@ -216,6 +219,11 @@ case "$1" in
             listunspent)
                 zcash_rpc zcbenchmark listunspent 10
                 ;;
+            createsaplingtransaction)
+                # serial build, then the descriptions prepared on every core
+                zcash_rpc zcbenchmark createsaplingtransaction 10 "${3:-10}" 1
+                zcash_rpc zcbenchmark createsaplingtransaction 10 "${3:-10}" "$(nproc)"
+                ;;
             *)
                 zcashd_stop
                 echo "Bad arguments to time."
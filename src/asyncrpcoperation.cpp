@@ -42,7 +42,7 @@ static std::map<OperationStatus, std::string> OperationStatusMap = {
 /**
  * Every operation instance should have a globally unique id
  */
-AsyncRPCOperation::AsyncRPCOperation() : error_code_(0), error_message_() {
+AsyncRPCOperation::AsyncRPCOperation() : error_code_(0), error_message_(), proofs_done_(0), proofs_total_(0) {
     // Set a unique reference for each operation
     boost::uuids::uuid uuid = uuidgen();
     id_ = "opid-" + boost::uuids::to_string(uuid);
@@ -54,7 +54,7 @@ AsyncRPCOperation::AsyncRPCOperation(const AsyncRPCOperation& o) :
         id_(o.id_), creation_time_(o.creation_time_), state_(o.state_.load()),
         start_time_(o.start_time_), end_time_(o.end_time_),
         error_code_(o.error_code_), error_message_(o.error_message_),
-        result_(o.result_)
+        result_(o.result_), proofs_done_(o.proofs_done_.load()), proofs_total_(o.proofs_total_.load())
 {
 }
 
@@ -67,6 +67,8 @@ AsyncRPCOperation& AsyncRPCOperation::operator=( const AsyncRPCOperation& other
     this->error_code_ = other.error_code_;
     this->error_message_ = other.error_message_;
     this->result_ = other.result_;
+    this->proofs_done_.store(other.proofs_done_.load());
+    this->proofs_total_.store(other.proofs_total_.load());
     return *this;
 }
 
@@ -171,6 +173,13 @@ UniValue AsyncRPCOperation::getStatus() const {
     obj.push_back(Pair("status", OperationStatusMap[status]));
     obj.push_back(Pair("creation_time", this->creation_time_));
     // TODO: Issue #1354: There may be other useful metadata to return to the user.
+    size_t proofsTotal = proofs_total_.load();
+    if (status == OperationStatus::EXECUTING && proofsTotal > 0) {
+        UniValue proofs(UniValue::VOBJ);
+        proofs.push_back(Pair("done", (uint64_t)proofs_done_.load()));
+        proofs.push_back(Pair("total", (uint64_t)proofsTotal));
+        obj.push_back(Pair("proofs", proofs));
+    }
     UniValue err = this->getError();
     if (!err.isNull()) {
         obj.push_back(Pair("error", err.get_obj()));
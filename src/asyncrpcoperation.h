@@ -129,6 +129,8 @@ protected:
     std::string error_message_;
     std::atomic<OperationStatus> state_;
     std::chrono::time_point<std::chrono::system_clock> start_time_, end_time_;  
+    // Sapling proofs created so far while building the transaction, reported by getStatus()
+    std::atomic<size_t> proofs_done_, proofs_total_;
 
     void start_execution_clock();
     void stop_execution_clock();
@@ -151,6 +153,11 @@ protected:
         std::lock_guard<std::mutex> guard(lock_);
         this->result_ = v;
     }
+
+    void set_proof_progress(size_t done, size_t total) {
+        this->proofs_total_.store(total);
+        this->proofs_done_.store(done);
+    }
     
 private:
 
@@ -17,9 +17,43 @@
 #include "CCtokens.h"
 
 
-UniValue AssetOrders(uint256 refassetid, CPubKey pk, uint8_t additionalEvalCode)
+// order tx data needed to list an open order, decoded once per txid:
+// an order tx never changes, whether the order is still open is told by the unspent index
+struct CAssetOrderData {
+    uint8_t funcid;
+    uint256 assetid, assetid2;
+    int64_t price, vout0Value;
+    std::vector<uint8_t> origpubkey;
+};
+
+static CCBoundedCache<uint256, CAssetOrderData> assetOrdersCache(100000);
+
+static bool GetAssetOrderData(const uint256 &txid, CAssetOrderData &order)
+{
+    if (assetOrdersCache.Get(txid, order))
+        return order.funcid != 0;
+
+    CTransaction ordertx;
+    uint256 hashBlock;
+    uint8_t evalCode;
+
+    if (myGetTransaction(txid, ordertx, hashBlock) == 0)
+        return false;  // not cached, may be found later
+    order.funcid = 0;
+    if (ordertx.vout.size() > 0)
+        order.funcid = DecodeAssetTokenOpRet(ordertx.vout.back().scriptPubKey, evalCode, order.assetid, order.assetid2, order.price, order.origpubkey);
+    order.vout0Value = ordertx.vout.size() > 0 ? ordertx.vout[0].nValue : 0;
+
+    assetOrdersCache.Add(txid, order);
+    return order.funcid != 0;
+}
+
+// returns open orders sorted by tokenid, then bids from the highest price and asks from the lowest price
+// skips the first 'skip' orders and returns no more than 'count' orders if count is not 0
+UniValue AssetOrders(uint256 refassetid, CPubKey pk, uint8_t additionalEvalCode, int32_t count, int32_t skip)
 {
 	UniValue result(UniValue::VARR);  
+    std::vector<std::pair<std::tuple<uint256, bool, double>, UniValue> > orders;
 
     struct CCcontract_info *cpAssets, assetsC;
     struct CCcontract_info *cpTokens, tokensC;
@@ -29,28 +63,33 @@ UniValue AssetOrders(uint256 refassetid, CPubKey pk, uint8_t additionalEvalCode)
 
 	auto addOrders = [&](struct CCcontract_info *cp, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it)
 	{
-		uint256 txid, hashBlock, assetid, assetid2;
-		int64_t price;
+		uint256 txid, assetid, assetid2;
+		int64_t price, nValue;
 		std::vector<uint8_t> origpubkey;
-		CTransaction ordertx;
-		uint8_t funcid, evalCode;
+		CAssetOrderData order;
+		uint8_t funcid;
 		char numstr[32], funcidstr[16], origaddr[64], origtokenaddr[64];
+		double unitprice = 0;
 
         txid = it->first.txhash;
         LOGSTREAM("ccassets", CCLOG_DEBUG2, stream << "addOrders() checking txid=" << txid.GetHex() << std::endl);
-        if ( myGetTransaction(txid, ordertx, hashBlock) != 0 )
+        if (GetAssetOrderData(txid, order))
         {
-			// for logging: funcid = DecodeAssetOpRet(vintx.vout[vintx.vout.size() - 1].scriptPubKey, evalCode, assetid, assetid2, price, origpubkey);
-            if (ordertx.vout.size() > 0 && (funcid = DecodeAssetTokenOpRet(ordertx.vout[ordertx.vout.size()-1].scriptPubKey, evalCode, assetid, assetid2, price, origpubkey)) != 0)
+            funcid = order.funcid;
+            assetid = order.assetid;
+            assetid2 = order.assetid2;
+            price = order.price;
+            origpubkey = order.origpubkey;
+            nValue = it->second.satoshis;
             {
-                LOGSTREAM("ccassets", CCLOG_DEBUG2, stream << "addOrders() checking ordertx.vout.size()=" << ordertx.vout.size() << " funcid=" << (char)(funcid ? funcid : ' ') << " assetid=" << assetid.GetHex() << std::endl);
+                LOGSTREAM("ccassets", CCLOG_DEBUG2, stream << "addOrders() checking funcid=" << (char)(funcid ? funcid : ' ') << " assetid=" << assetid.GetHex() << std::endl);
 
                 if (pk == CPubKey() && (refassetid == zeroid || assetid == refassetid)  // tokenorders
                     || pk != CPubKey() && pk == pubkey2pk(origpubkey) && (funcid == 'S' || funcid == 's'))  // mytokenorders, returns only asks (is this correct?)
                 {
 
-                    LOGSTREAM("ccassets", CCLOG_DEBUG2, stream << "addOrders() it->first.index=" << it->first.index << " ordertx.vout[it->first.index].nValue=" << ordertx.vout[it->first.index].nValue << std::endl);
-                    if (ordertx.vout[it->first.index].nValue == 0) {
+                    LOGSTREAM("ccassets", CCLOG_DEBUG2, stream << "addOrders() it->first.index=" << it->first.index << " nValue=" << nValue << std::endl);
+                    if (nValue == 0) {
                         LOGSTREAM("ccassets", CCLOG_DEBUG2, stream << "addOrders() order with value=0 skipped" << std::endl);
                         return;
                     }
@@ -64,16 +103,16 @@ UniValue AssetOrders(uint256 refassetid, CPubKey pk, uint8_t additionalEvalCode)
                     item.push_back(Pair("vout", (int64_t)it->first.index));
                     if (funcid == 'b' || funcid == 'B')
                     {
-                        sprintf(numstr, "%.8f", (double)ordertx.vout[it->first.index].nValue / COIN);
+                        sprintf(numstr, "%.8f", (double)nValue / COIN);
                         item.push_back(Pair("amount", numstr));
-                        sprintf(numstr, "%.8f", (double)ordertx.vout[0].nValue / COIN);
+                        sprintf(numstr, "%.8f", (double)order.vout0Value / COIN);
                         item.push_back(Pair("bidamount", numstr));
                     }
                     else
                     {
-                        sprintf(numstr, "%llu", (long long)ordertx.vout[it->first.index].nValue);
+                        sprintf(numstr, "%llu", (long long)nValue);
                         item.push_back(Pair("amount", numstr));
-                        sprintf(numstr, "%llu", (long long)ordertx.vout[0].nValue);
+                        sprintf(numstr, "%llu", (long long)order.vout0Value);
                         item.push_back(Pair("askamount", numstr));
                     }
                     if (origpubkey.size() == CPubKey::COMPRESSED_PUBLIC_KEY_SIZE)
@@ -93,18 +132,22 @@ UniValue AssetOrders(uint256 refassetid, CPubKey pk, uint8_t additionalEvalCode)
                         {
                             sprintf(numstr, "%.8f", (double)price / COIN);
                             item.push_back(Pair("totalrequired", numstr));
-                            sprintf(numstr, "%.8f", (double)price / (COIN * ordertx.vout[0].nValue));
+                            unitprice = (double)price / (COIN * order.vout0Value);
+                            sprintf(numstr, "%.8f", unitprice);
                             item.push_back(Pair("price", numstr));
                         }
                         else
                         {
                             item.push_back(Pair("totalrequired", (int64_t)price));
-                            sprintf(numstr, "%.8f", (double)ordertx.vout[0].nValue / (price * COIN));
+                            unitprice = (double)order.vout0Value / (price * COIN);
+                            sprintf(numstr, "%.8f", unitprice);
                             item.push_back(Pair("price", numstr));
                         }
                     }
-                    result.push_back(item);
-                    LOGSTREAM("ccassets", CCLOG_DEBUG1, stream << "addOrders() added order funcId=" << (char)(funcid ? funcid : ' ') << " it->first.index=" << it->first.index << " ordertx.vout[it->first.index].nValue=" << ordertx.vout[it->first.index].nValue << " tokenid=" << assetid.GetHex() << std::endl);
+                    // bids go first, the best price first
+                    bool isAsk = !(funcid == 'b' || funcid == 'B');
+                    orders.push_back(std::make_pair(std::make_tuple(assetid, isAsk, isAsk ? unitprice : -unitprice), item));
+                    LOGSTREAM("ccassets", CCLOG_DEBUG1, stream << "addOrders() added order funcId=" << (char)(funcid ? funcid : ' ') << " it->first.index=" << it->first.index << " nValue=" << nValue << " tokenid=" << assetid.GetHex() << std::endl);
                 }
             }
         }
@@ -151,6 +194,15 @@ UniValue AssetOrders(uint256 refassetid, CPubKey pk, uint8_t additionalEvalCode)
             itDualEvalTokens++)
             addOrders(cpAssets, itDualEvalTokens);
     }
+
+    std::stable_sort(orders.begin(), orders.end(),
+        [](const std::pair<std::tuple<uint256, bool, double>, UniValue> &a, const std::pair<std::tuple<uint256, bool, double>, UniValue> &b) { return a.first < b.first; });
+    size_t first = skip > 0 ? (size_t)skip : 0;
+    size_t last = orders.size();
+    if (count > 0 && first < last && last - first > (size_t)count)
+        last = first + count;
+    for (size_t i = first; i < last; i++)
+        result.push_back(orders[i].second);
     return(result);
 }
 
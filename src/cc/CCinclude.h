@@ -302,10 +302,11 @@ int64_t CCgettxout(uint256 txid,int32_t vout,int32_t mempoolflag,int32_t lockfla
 
 /// \cond INTERNAL
 bool myIsutxo_spentinmempool(uint256 &spenttxid,int32_t &spentvini,uint256 txid,int32_t vout);
+int32_t myIsutxos_spentinmempool(std::vector<bool> &spent,const std::vector<COutPoint> &outpoints);
 bool myAddtomempool(CTransaction &tx, CValidationState *pstate = NULL, bool fSkipExpiry = false);
 bool mytxid_inmempool(uint256 txid);
 int32_t myIsutxo_spent(uint256 &spenttxid,uint256 txid,int32_t vout);
-int32_t myGet_mempool_txs(std::vector<CTransaction> &txs,uint8_t evalcode,uint8_t funcid);
+int32_t myGet_mempool_txs(std::vector<CTransaction> &txs,uint8_t evalcode,uint8_t funcid,uint256 reftxid = zeroid);
 /// \endcond
 
 /// \cond INTERNAL
@@ -348,6 +349,18 @@ uint8_t DecodeOraclesCreateOpRet(const CScript &scriptPubKey,std::string &name,s
 uint8_t DecodeOraclesOpRet(const CScript &scriptPubKey,uint256 &oracletxid,CPubKey &pk,int64_t &num);
 uint8_t DecodeOraclesData(const CScript &scriptPubKey,uint256 &oracletxid,uint256 &batontxid,CPubKey &pk,std::vector <uint8_t>&data);
 int32_t oracle_format(uint256 *hashp,int64_t *valp,char *str,uint8_t fmt,uint8_t *data,int32_t offset,int32_t datalen);
+
+struct oracles_sample
+{
+    uint8_t funcid;
+    uint256 oracletxid,batontxid;
+    CPubKey pk;
+    std::vector<uint8_t> data;
+    int64_t markervalue;
+    std::string markeraddr;
+};
+bool GetOraclesSample(uint256 txid,struct oracles_sample &sample);
+void ClearOraclesSampleCache();
 /// \endcond
 
 /// Adds token inputs to transaction object. If tokenid is a non-fungible token then the function will set additionalTokensEvalcode2 variable in the cp object to the eval code from NFT data to spend NFT outputs properly
@@ -852,7 +865,9 @@ void SetCCunspents(std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValu
 /// @param[out] addressIndex vector of pairs of address index key and amount
 /// @param coinaddr address where the unspent outputs are searched
 /// @param CCflag if true the function searches for cc outputs, otherwise for normal outputs
-void SetCCtxids(std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,char *coinaddr,bool CCflag = true);
+/// @param startheight if not 0, only outputs at or above this height are returned (the index is seeked to it)
+/// @param endheight if not 0, only outputs at or below this height are returned
+void SetCCtxids(std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,char *coinaddr,bool CCflag = true,int32_t startheight = 0,int32_t endheight = 0);
 
 /// overloaded SetCCtxids returns a vector of filtered txids which have outputs on an address
 /// @param[out] txids returned vector of txids
@@ -907,6 +922,51 @@ int64_t AddNormalinputs2(CMutableTransaction &mtx,int64_t total,int32_t maxinput
 /// @returns amount of added normal inputs or amount of all normal inputs in the wallet
 int64_t AddNormalinputsRemote(CMutableTransaction &mtx, CPubKey mypk, int64_t total, int32_t maxinputs);
 
+/// CCBoundedCache is a thread-safe map for data that a module would otherwise load or decode again for the same key.
+/// Keys are expected to start with a txid: once the cache is full, adding a key evicts the lowest one, which is an arbitrary entry
+template <typename K, typename V>
+class CCBoundedCache
+{
+public:
+    /// @param maxsize maximum number of entries
+    explicit CCBoundedCache(size_t maxsize) : nMaxSize(maxsize) {}
+
+    /// @returns true and sets value if key is cached
+    bool Get(const K &key, V &value) const
+    {
+        LOCK(cs);
+        typename std::map<K, V>::const_iterator it = entries.find(key);
+        if (it == entries.end())
+            return false;
+        value = it->second;
+        return true;
+    }
+
+    void Add(const K &key, const V &value)
+    {
+        LOCK(cs);
+        if (entries.size() >= nMaxSize && entries.count(key) == 0)
+            entries.erase(entries.begin());
+        entries[key] = value;
+    }
+
+    void Clear()
+    {
+        LOCK(cs);
+        entries.clear();
+    }
+
+private:
+    mutable CCriticalSection cs;
+    std::map<K, V> entries;
+    const size_t nMaxSize;
+};
+
+/// CCreleaseinputs frees the inputs that FinalizeCCTx reserved for a tx.
+/// Until released or for a minute, AddNormalinputsLocal and AddNormalinputsRemote do not hand reserved utxos out to other txs
+/// @param tx transaction that was broadcast or rejected
+void CCreleaseinputs(const CTransaction &tx);
+
 /// CCutxovalue returns amount of an utxo. The function does this without loading the utxo transaction, by using address index only
 /// @param coinaddr address where the utxo is searched
 /// @param utxotxid transaction id of the utxo
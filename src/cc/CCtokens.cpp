@@ -267,12 +267,42 @@ void FilterOutNonCCOprets(const std::vector<std::pair<uint8_t, vscript_t>>  &opr
     }
 }
 
+// cache of the vouts found valid by IsTokensvout(goDeeper=true): (txid, vout, tokenid) -> tokenoshis
+// so that a spent token vout is validated with its ancestors once, not again for each spending tx,
+// for every cc vin and both in the mempool and at block connect.
+// Only valid results are kept: they depend on the tx and its ancestors, which the txid commits to,
+// apart from the tokenbase tx that may be reorged out, so the cache is cleared on block disconnect
+static CCBoundedCache<std::tuple<uint256, int32_t, uint256>, int64_t> tokensValidationCache(50000);
+
+void ClearTokensValidationCache()
+{
+    tokensValidationCache.Clear();
+}
+
+static int64_t CheckTokensvout(bool goDeeper, bool checkPubkeys, struct CCcontract_info *cp, Eval* eval, const CTransaction& tx, int32_t v, uint256 reftokenid);
+
 // Checks if the vout is a really Tokens CC vout
 // also checks tokenid in opret or txid if this is 'c' tx
 // goDeeper is true: the func also validates amounts of the passed transaction: 
 // it should be either sum(cc vins) == sum(cc vouts) or the transaction is the 'tokenbase' ('c') tx
 // checkPubkeys is true: validates if the vout is token vout1 or token vout1of2. Should always be true!
 int64_t IsTokensvout(bool goDeeper, bool checkPubkeys /*<--not used, always true*/, struct CCcontract_info *cp, Eval* eval, const CTransaction& tx, int32_t v, uint256 reftokenid)
+{
+    int64_t tokenoshis;
+
+    if (!goDeeper)
+        return CheckTokensvout(goDeeper, checkPubkeys, cp, eval, tx, v, reftokenid);
+
+    if (tokensValidationCache.Get(std::make_tuple(tx.GetHash(), v, reftokenid), tokenoshis)) {
+        LOGSTREAM((char *)"cctokens", CCLOG_DEBUG2, stream << "IsTokensvout() cached amount=" << tokenoshis << " for txid=" << tx.GetHash().GetHex() << " v=" << v << " for tokenid=" << reftokenid.GetHex() << std::endl);
+        return tokenoshis;
+    }
+    if ((tokenoshis = CheckTokensvout(goDeeper, checkPubkeys, cp, eval, tx, v, reftokenid)) > 0)
+        tokensValidationCache.Add(std::make_tuple(tx.GetHash(), v, reftokenid), tokenoshis);
+    return tokenoshis;
+}
+
+static int64_t CheckTokensvout(bool goDeeper, bool checkPubkeys, struct CCcontract_info *cp, Eval* eval, const CTransaction& tx, int32_t v, uint256 reftokenid)
 {
 
 	// this is just for log messages indentation fur debugging recursive calls:
@@ -915,15 +945,86 @@ std::string TokenTransfer(int64_t txfee, uint256 tokenid, vscript_t destpubkey,
 }
 
 
+// for the token index: finds the vouts of a confirmed tx which AddTokenCCInputs() would add for some pubkey,
+// that is valid token vouts sent to the token cc address of one of the tx pubkeys
+// returns the tokenid, or zeroid if the tx has no token opret. For the 'tokenbase' tx supply is set as in TokenInfo()
+uint256 GetTokenIndexOutputs(const CTransaction &tx, std::vector<std::pair<int32_t, CTokenOutputValue>> &outputs, int64_t &supply)
+{
+    uint8_t evalcode, funcid;
+    uint256 tokenid;
+    std::vector<CPubKey> voutPubkeys, vinPubkeys, pubkeys;
+    std::vector<std::pair<uint8_t, vscript_t>> oprets;
+    std::vector<uint8_t> origpubkey;
+    std::string name, description;
+    vscript_t vopretNonfungible;
+    struct CCcontract_info *cp, C;
+
+    outputs.clear();
+    supply = 0;
+    if (tx.vout.size() < 2 || (funcid = DecodeTokenOpRet(tx.vout.back().scriptPubKey, evalcode, tokenid, voutPubkeys, oprets)) == 0)
+        return zeroid;
+
+    cp = CCinit(&C, EVAL_TOKENS);
+    if (funcid == 'c') {
+        tokenid = tx.GetHash();
+        if (DecodeTokenCreateOpRet(tx.vout.back().scriptPubKey, origpubkey, name, description) == 'c')
+            voutPubkeys.push_back(pubkey2pk(origpubkey));
+        for (int32_t v = 0; v < tx.vout.size() - 1; v++)
+            supply += IsTokensvout(false, true, cp, NULL, tx, v, tokenid);
+    }
+    if (tokenid == zeroid)
+        return zeroid;
+
+    // the same as IsTokensvout(goDeeper=true) does for every vout:
+    int64_t inputs, outs;
+    if (!TokensExactAmounts(false, cp, inputs, outs, NULL, tx, tokenid) && tokenid != tx.GetHash())
+        return tokenid;
+
+    GetNonfungibleData(tokenid, vopretNonfungible);
+    if (vopretNonfungible.size() > 0)
+        cp->additionalTokensEvalcode2 = vopretNonfungible.begin()[0];
+
+    ExtractTokensCCVinPubkeys(tx, vinPubkeys);
+    pubkeys = voutPubkeys;
+    pubkeys.insert(pubkeys.end(), vinPubkeys.begin(), vinPubkeys.end());
+
+    std::vector<std::string> tokenaddrs;
+    for (const auto &pk : pubkeys) {
+        char tokenaddr[64];
+        GetTokensCCaddress(cp, tokenaddr, pk);
+        tokenaddrs.push_back(tokenaddr);
+    }
+
+    for (int32_t v = 0; v < tx.vout.size() - 1; v++)
+    {
+        char destaddr[64];
+        int64_t nValue;
+
+        if (!tx.vout[v].scriptPubKey.IsPayToCryptoCondition() || !Getscriptaddress(destaddr, tx.vout[v].scriptPubKey))
+            continue;
+        for (int32_t i = 0; i < tokenaddrs.size(); i++)
+            if (tokenaddrs[i] == destaddr) {
+                if ((nValue = IsTokensvout(false, true, cp, NULL, tx, v, tokenid)) > 0)
+                    outputs.push_back(std::make_pair(v, CTokenOutputValue(tokenid, pubkeys[i], nValue)));
+                break;
+            }
+    }
+    return tokenid;
+}
+
 int64_t GetTokenBalance(CPubKey pk, uint256 tokenid)
 {
 	uint256 hashBlock;
 	CMutableTransaction mtx = CreateNewContextualCMutableTransaction(Params().GetConsensus(), komodo_nextheight());
 	CTransaction tokentx;
+	CAmount balance;
 
 	// CCerror = strprintf("obsolete, cannot return correct value without eval");
 	// return 0;
 
+	if (fTokenIndex && GetTokenIndexBalance(tokenid, pk, balance))
+		return balance;
+
 	if (myGetTransaction(tokenid, tokentx, hashBlock) == 0)
 	{
         LOGSTREAM((char *)"cctokens", CCLOG_INFO, stream << "cant find tokenid" << std::endl);
@@ -975,10 +1076,16 @@ UniValue TokenInfo(uint256 tokenid)
 	result.push_back(Pair("name", name));
 
     int64_t supply = 0, output;
-    for (int v = 0; v < tokenbaseTx.vout.size() - 1; v++)
-        if ((output = IsTokensvout(false, true, cpTokens, NULL, tokenbaseTx, v, tokenid)) > 0)
-            supply += output;
+    CTokenInfoValue info;
+    if (fTokenIndex && GetTokenIndexInfo(tokenid, info))
+        supply = info.supply;
+    else
+        for (int v = 0; v < tokenbaseTx.vout.size() - 1; v++)
+            if ((output = IsTokensvout(false, true, cpTokens, NULL, tokenbaseTx, v, tokenid)) > 0)
+                supply += output;
 	result.push_back(Pair("supply", supply));
+    if (!info.IsNull())
+        result.push_back(Pair("holders", (int64_t)info.holders));
 	result.push_back(Pair("description", description));
 
     GetOpretBlob(oprets, OPRETID_NONFUNGIBLEDATA, vopretNonfungible);
@@ -1034,6 +1141,13 @@ UniValue TokenList()
 
 	cp = CCinit(&C, EVAL_TOKENS);
 
+    // the token index has every confirmed tokenbase tx, no need to load them
+    if (fTokenIndex && GetTokenIndexList(txids)) {
+        for (std::vector<uint256>::const_iterator it = txids.begin(); it != txids.end(); it++)
+            result.push_back(it->GetHex());
+        return(result);
+    }
+
     auto addTokenId = [&](uint256 txid) {
         if (myGetTransaction(txid, vintx, hashBlock) != 0) {
             if (vintx.vout.size() > 0 && DecodeTokenCreateOpRet(vintx.vout[vintx.vout.size() - 1].scriptPubKey, origpubkey, name, description) != 0) {
@@ -33,9 +33,11 @@ std::string TokenTransfer(int64_t txfee, uint256 assetid, std::vector<uint8_t> d
 int64_t HasBurnedTokensvouts(struct CCcontract_info *cp, Eval* eval, const CTransaction& tx, uint256 reftokenid);
 CPubKey GetTokenOriginatorPubKey(CScript scriptPubKey);
 bool IsTokenMarkerVout(CTxOut vout);
+void ClearTokensValidationCache();
 
 int64_t GetTokenBalance(CPubKey pk, uint256 tokenid);
 UniValue TokenInfo(uint256 tokenid);
 UniValue TokenList();
+uint256 GetTokenIndexOutputs(const CTransaction &tx, std::vector<std::pair<int32_t, CTokenOutputValue>> &outputs, int64_t &supply);
 
 #endif
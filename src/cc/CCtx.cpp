@@ -19,6 +19,39 @@
 std::vector<CPubKey> NULL_pubkeys;
 struct NSPV_CCmtxinfo NSPV_U;
 
+// inputs of CC txs that were finalized but are not in the mempool yet, so that concurrent rpc calls dont build
+// conflicting txs from the same utxos. A reservation lapses after CC_RESERVE_SECONDS in case the tx is never broadcast
+#define CC_RESERVE_SECONDS 60
+static CCriticalSection cs_CCreserved;
+static std::map<COutPoint,int64_t> CCreserved;
+
+static bool CCisreserved(uint256 txid,int32_t vout,int64_t now)
+{
+    LOCK(cs_CCreserved);
+    std::map<COutPoint,int64_t>::iterator it = CCreserved.find(COutPoint(txid,vout));
+    if ( it == CCreserved.end() )
+        return(false);
+    if ( it->second > now )
+        return(true);
+    CCreserved.erase(it);
+    return(false);
+}
+
+static void CCreserveinputs(const CMutableTransaction &mtx)
+{
+    int64_t expiry = GetTime() + CC_RESERVE_SECONDS;
+    LOCK(cs_CCreserved);
+    for (int32_t i=0; i<mtx.vin.size(); i++)
+        CCreserved[mtx.vin[i].prevout] = expiry;
+}
+
+void CCreleaseinputs(const CTransaction &tx)
+{
+    LOCK(cs_CCreserved);
+    for (int32_t i=0; i<tx.vin.size(); i++)
+        CCreserved.erase(tx.vin[i].prevout);
+}
+
 /* see description to function definition in CCinclude.h */
 bool SignTx(CMutableTransaction &mtx,int32_t vini,int64_t utxovalue,const CScript scriptPubKey)
 {
@@ -382,7 +415,10 @@ UniValue FinalizeCCTxExt(bool remote, uint64_t CCmask, struct CCcontract_info *c
     memset(myprivkey,0,sizeof(myprivkey));
     std::string strHex = EncodeHexTx(mtx);
     if ( strHex.size() > 0 )
+    {
+        CCreserveinputs(mtx);
         result.push_back(Pair(JSON_HEXTX, strHex));
+    }
     else {
         result.push_back(Pair(JSON_HEXTX, "0"));
     }
@@ -418,7 +454,7 @@ void SetCCunspents(std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValu
     }
 }
 
-void SetCCtxids(std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,char *coinaddr,bool ccflag)
+void SetCCtxids(std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,char *coinaddr,bool ccflag,int32_t startheight,int32_t endheight)
 {
     int32_t type=0,i,n; char *ptr; std::string addrstr; uint160 hashBytes; std::vector<std::pair<uint160, int> > addresses;
     if ( KOMODO_NSPV_SUPERLITE )
@@ -437,7 +473,8 @@ void SetCCtxids(std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex
     addresses.push_back(std::make_pair(hashBytes,type));
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++)
     {
-        if ( GetAddressIndex((*it).first, (*it).second, addressIndex) == 0 )
+        // the index is only seeked to startheight when an end is given too
+        if ( GetAddressIndex((*it).first, (*it).second, addressIndex, startheight, startheight > 0 && endheight <= 0 ? std::numeric_limits<int32_t>::max() : endheight) == 0 )
             return;
     }
 }
@@ -636,7 +673,7 @@ int32_t CC_vinselect(int32_t *aboveip,int64_t *abovep,int32_t *belowip,int64_t *
 
 int64_t AddNormalinputsLocal(CMutableTransaction &mtx,CPubKey mypk,int64_t total,int32_t maxinputs)
 {
-    int32_t abovei,belowi,ind,vout,i,n = 0; int64_t sum,threshold,above,below; int64_t remains,nValue,totalinputs = 0; uint256 txid,hashBlock; std::vector<COutput> vecOutputs; CTransaction tx; struct CC_utxo *utxos,*up;
+    int32_t abovei,belowi,ind,vout,i,n = 0; int64_t sum,threshold,above,below,now = GetTime(); int64_t remains,nValue,totalinputs = 0; uint256 txid; std::vector<COutput> vecOutputs; struct CC_utxo *utxos,*up;
     if ( KOMODO_NSPV_SUPERLITE )
         return(NSPV_AddNormalinputs(mtx,mypk,total,maxinputs,&NSPV_U));
 
@@ -661,7 +698,7 @@ int64_t AddNormalinputsLocal(CMutableTransaction &mtx,CPubKey mypk,int64_t total
         {
             txid = out.tx->GetHash();
             vout = out.i;
-            if ( myGetTransaction(txid,tx,hashBlock) != 0 && tx.vout.size() > 0 && vout < tx.vout.size() && tx.vout[vout].scriptPubKey.IsPayToCryptoCondition() == 0 )
+            if ( out.tx->vout[vout].scriptPubKey.IsPayToCryptoCondition() == 0 && CCisreserved(txid,vout,now) == 0 )
             {
                 //fprintf(stderr,"check %.8f to vins array.%d of %d %s/v%d\n",(double)out.tx->vout[out.i].nValue/COIN,n,maxutxos,txid.GetHex().c_str(),(int32_t)vout);
                 if ( mtx.vin.size() > 0 )
@@ -744,7 +781,7 @@ int64_t AddNormalinputs2(CMutableTransaction &mtx, int64_t total, int32_t maxinp
 // has additional mypk param for nspv calls
 int64_t AddNormalinputsRemote(CMutableTransaction &mtx, CPubKey mypk, int64_t total, int32_t maxinputs)
 {
-    int32_t abovei,belowi,ind,vout,i,n = 0; int64_t sum,threshold,above,below; int64_t remains,nValue,totalinputs = 0; char coinaddr[64]; uint256 txid,hashBlock; CTransaction tx; struct CC_utxo *utxos,*up;
+    int32_t abovei,belowi,ind,vout,i,n = 0; int64_t sum,threshold,above,below,now = GetTime(); int64_t remains,nValue,totalinputs = 0; char coinaddr[64]; uint256 txid; struct CC_utxo *utxos,*up;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
     if ( KOMODO_NSPV_SUPERLITE )
         return(NSPV_AddNormalinputs(mtx,mypk,total,maxinputs,&NSPV_U));
@@ -757,13 +794,20 @@ int64_t AddNormalinputsRemote(CMutableTransaction &mtx, CPubKey mypk, int64_t to
     sum = 0;
     Getscriptaddress(coinaddr,CScript() << vscript_t(mypk.begin(), mypk.end()) << OP_CHECKSIG);
     SetCCunspents(unspentOutputs,coinaddr,false);
+    // check all candidates against the mempool at once, before loading any of them
+    std::vector<COutPoint> outpoints; std::vector<bool> spent;
+    outpoints.reserve(unspentOutputs.size());
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
+        outpoints.push_back(COutPoint(it->first.txhash,it->first.index));
+    myIsutxos_spentinmempool(spent,outpoints);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
         txid = it->first.txhash;
         vout = (int32_t)it->first.index;
-        if ( it->second.satoshis < threshold )
+        if ( it->second.satoshis < threshold || spent[it - unspentOutputs.begin()] != 0 )
             continue;
-        if ( myGetTransaction(txid,tx,hashBlock) != 0 && tx.vout.size() > 0 && vout < tx.vout.size() && tx.vout[vout].scriptPubKey.IsPayToCryptoCondition() == 0 )
+        // the unspent index holds the output script, no need to load the tx
+        if ( it->second.script.IsPayToCryptoCondition() == 0 && CCisreserved(txid,vout,now) == 0 )
         {
             //fprintf(stderr,"check %.8f to vins array.%d of %d %s/v%d\n",(double)out.tx->vout[out.i].nValue/COIN,n,maxutxos,txid.GetHex().c_str(),(int32_t)vout);
             if ( mtx.vin.size() > 0 )
@@ -782,17 +826,14 @@ int64_t AddNormalinputsRemote(CMutableTransaction &mtx, CPubKey mypk, int64_t to
                 if ( i != n )
                     continue;
             }
-            if ( myIsutxo_spentinmempool(ignoretxid,ignorevin,txid,vout) == 0 )
-            {
-                up = &utxos[n++];
-                up->txid = txid;
-                up->nValue = it->second.satoshis;
-                up->vout = vout;
-                sum += up->nValue;
-                //fprintf(stderr,"add %.8f to vins array.%d of %d\n",(double)up->nValue/COIN,n,maxutxos);
-                if ( n >= maxinputs || sum >= total )
-                    break;
-            }
+            up = &utxos[n++];
+            up->txid = txid;
+            up->nValue = it->second.satoshis;
+            up->vout = vout;
+            sum += up->nValue;
+            //fprintf(stderr,"add %.8f to vins array.%d of %d\n",(double)up->nValue/COIN,n,maxutxos);
+            if ( n >= maxinputs || sum >= total )
+                break;
         }
     }
     remains = total;
@@ -548,16 +548,17 @@ int64_t CCduration(int32_t &numblocks,uint256 txid)
 
 uint256 CCOraclesReverseScan(char const *logcategory,uint256 &txid,int32_t height,uint256 reforacletxid,uint256 batontxid)
 {
-    CTransaction tx; uint256 hash,mhash,bhash,hashBlock,oracletxid; int32_t len,len2,numvouts;
-    int64_t val,merkleht; CPubKey pk; std::vector<uint8_t>data; char str[65],str2[65];
+    uint256 hash,mhash; int32_t len,len2; struct oracles_sample sample;
+    int64_t val,merkleht; char str[65],str2[65];
     
     txid = zeroid;
     LogPrint(logcategory,"start reverse scan %s\n",uint256_str(str,batontxid));
-    while ( myGetTransaction(batontxid,tx,hashBlock) != 0 && (numvouts= tx.vout.size()) > 0 )
+    while ( GetOraclesSample(batontxid,sample) != 0 )
     {
         LogPrint(logcategory,"check %s\n",uint256_str(str,batontxid));
-        if ( DecodeOraclesData(tx.vout[numvouts-1].scriptPubKey,oracletxid,bhash,pk,data) == 'D' && oracletxid == reforacletxid )
+        if ( sample.funcid == 'D' && sample.oracletxid == reforacletxid )
         {
+            const std::vector<uint8_t> &data = sample.data;
             LogPrint(logcategory,"decoded %s\n",uint256_str(str,batontxid));
             if ( oracle_format(&hash,&merkleht,0,'I',(uint8_t *)data.data(),0,(int32_t)data.size()) == sizeof(int32_t) && merkleht == height )
             {
@@ -578,7 +579,7 @@ uint256 CCOraclesReverseScan(char const *logcategory,uint256 &txid,int32_t heigh
                 }
             }
             else LogPrint(logcategory,"height.%d vs search ht.%d\n",(int32_t)merkleht,(int32_t)height);
-            batontxid = bhash;
+            batontxid = sample.batontxid;
             LogPrint(logcategory,"new hash %s\n",uint256_str(str,batontxid));
         } else break;
     }
@@ -616,9 +617,9 @@ int32_t myIs_coinaddr_inmempoolvout(char const *logcategory,char *coinaddr)
 extern struct NSPV_mempoolresp NSPV_mempoolresult;
 extern bool NSPV_evalcode_inmempool(uint8_t evalcode,uint8_t funcid);
 
-int32_t myGet_mempool_txs(std::vector<CTransaction> &txs,uint8_t evalcode,uint8_t funcid)
+int32_t myGet_mempool_txs(std::vector<CTransaction> &txs,uint8_t evalcode,uint8_t funcid,uint256 reftxid)
 {
-    int i=0;
+    size_t n = txs.size();
 
     if ( KOMODO_NSPV_SUPERLITE )
     {
@@ -631,12 +632,13 @@ int32_t myGet_mempool_txs(std::vector<CTransaction> &txs,uint8_t evalcode,uint8_
         }
         return (NSPV_mempoolresult.numtxids);
     }
-    BOOST_FOREACH(const CTxMemPoolEntry &e,mempool.mapTx)
-    {
-        txs.push_back(e.GetTx());
-        i++;
-    }
-    return(i);
+    // only the matching transactions are copied out of the mempool; token
+    // transactions carry the opret of the module inside their own, so they
+    // are always included for the caller to decode
+    mempool.getCCTransactions(txs,evalcode,funcid,reftxid);
+    if ( evalcode != EVAL_TOKENS )
+        mempool.getCCTransactions(txs,EVAL_TOKENS);
+    return((int32_t)(txs.size() - n));
 }
 
 int32_t CCCointxidExists(char const *logcategory,uint256 cointxid)
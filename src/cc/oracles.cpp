@@ -166,6 +166,36 @@ uint8_t DecodeOraclesData(const CScript &scriptPubKey,uint256 &oracletxid,uint25
     return(0);
 }
 
+// decoded oracle txs by txid, funcid is 'D' for data txs, so that the samples of an oracle and the baton chains are not loaded and decoded again on every query.
+// Only confirmed txs are cached and the cache is cleared on block disconnect, so a cached tx can always be loaded as well
+static CCBoundedCache<uint256,struct oracles_sample> oraclesSampleCache(100000);
+
+bool GetOraclesSample(uint256 txid,struct oracles_sample &sample)
+{
+    CTransaction tx; uint256 hashBlock; char markeraddr[64]; int32_t numvouts;
+    if ( oraclesSampleCache.Get(txid,sample) )
+        return(true);
+    if ( myGetTransaction(txid,tx,hashBlock) == 0 || (numvouts= tx.vout.size()) == 0 )
+        return(false);
+    sample.funcid = DecodeOraclesData(tx.vout[numvouts-1].scriptPubKey,sample.oracletxid,sample.batontxid,sample.pk,sample.data);
+    sample.markervalue = 0;
+    sample.markeraddr.clear();
+    if ( numvouts > 1 )
+    {
+        sample.markervalue = tx.vout[1].nValue;
+        if ( Getscriptaddress(markeraddr,tx.vout[1].scriptPubKey) != 0 )
+            sample.markeraddr = markeraddr;
+    }
+    if ( hashBlock != zeroid )
+        oraclesSampleCache.Add(txid,sample);
+    return(true);
+}
+
+void ClearOraclesSampleCache()
+{
+    oraclesSampleCache.Clear();
+}
+
 CPubKey OracleBatonPk(char *batonaddr,struct CCcontract_info *cp)
 {
     static secp256k1_context *ctx;
@@ -247,17 +277,12 @@ int64_t OracleDatafee(CScript &scriptPubKey,uint256 oracletxid,CPubKey publisher
 
 static uint256 myIs_baton_spentinmempool(uint256 batontxid,int32_t batonvout)
 {
-    std::vector<CTransaction> tmp_txs;
-    myGet_mempool_txs(tmp_txs,EVAL_ORACLES,'D');
-    for (std::vector<CTransaction>::const_iterator it=tmp_txs.begin(); it!=tmp_txs.end(); it++)
+    uint256 txid; int32_t vini;
+    // the baton is always spent by the second input of the next data tx
+    if ( myIsutxo_spentinmempool(txid,vini,batontxid,batonvout) != 0 && vini == 1 )
     {
-        const CTransaction &tx = *it;
-        if ( tx.vout.size() > 0 && tx.vin.size() > 1 && batontxid == tx.vin[1].prevout.hash && batonvout == tx.vin[1].prevout.n )
-        {
-            const uint256 &txid = tx.GetHash();
-            //char str[65]; fprintf(stderr,"found baton spent in mempool %s\n",uint256_str(str,txid));
-            return(txid);
-        }
+        //char str[65]; fprintf(stderr,"found baton spent in mempool %s\n",uint256_str(str,txid));
+        return(txid);
     }
     return(batontxid);
 }
@@ -1037,22 +1062,22 @@ UniValue OracleFormat(uint8_t *data,int32_t datalen,char *format,int32_t formatl
 
 UniValue OracleDataSample(uint256 reforacletxid,uint256 txid)
 {
-    UniValue result(UniValue::VOBJ); CTransaction tx,oracletx; uint256 hashBlock,btxid,oracletxid;  std::string error;
-    CPubKey pk; std::string name,description,format; int32_t numvouts; std::vector<uint8_t> data; char str[67], *formatstr = 0;
+    UniValue result(UniValue::VOBJ); CTransaction oracletx; uint256 hashBlock;  std::string error; struct oracles_sample sample;
+    std::string name,description,format; int32_t numvouts; char str[67], *formatstr = 0;
     
     result.push_back(Pair("result","success"));
     if ( myGetTransaction(reforacletxid,oracletx,hashBlock) != 0 && (numvouts=oracletx.vout.size()) > 0 )
     {
         if ( DecodeOraclesCreateOpRet(oracletx.vout[numvouts-1].scriptPubKey,name,description,format) == 'C' )
         {
-            if ( myGetTransaction(txid,tx,hashBlock) != 0 && (numvouts=tx.vout.size()) > 0 )
+            if ( GetOraclesSample(txid,sample) != 0 )
             {
-                if ( DecodeOraclesData(tx.vout[numvouts-1].scriptPubKey,oracletxid,btxid,pk,data) == 'D' && reforacletxid == oracletxid )
+                if ( sample.funcid == 'D' && reforacletxid == sample.oracletxid )
                 {
                     if ( (formatstr= (char *)format.c_str()) == 0 )
                         formatstr = (char *)"";                    
                     result.push_back(Pair("txid",uint256_str(str,txid)));
-                    result.push_back(Pair("data",OracleFormat((uint8_t *)data.data(),(int32_t)data.size(),formatstr,(int32_t)format.size())));
+                    result.push_back(Pair("data",OracleFormat((uint8_t *)sample.data.data(),(int32_t)sample.data.size(),formatstr,(int32_t)format.size())));
                     return(result);                  
                 }
                 else error="invalid data tx";
@@ -1067,11 +1092,11 @@ UniValue OracleDataSample(uint256 reforacletxid,uint256 txid)
     return(result);
 }
 
-UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num)
+UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num,int32_t startheight,int32_t endheight)
 {
     UniValue result(UniValue::VOBJ),b(UniValue::VARR); CTransaction tx,oracletx; uint256 txid,hashBlock,btxid,oracletxid; 
     CPubKey pk; std::string name,description,format; int32_t numvouts,n=0,vout; std::vector<uint8_t> data; char *formatstr = 0, addr[64];
-    std::vector<uint256> txids; int64_t nValue;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex; struct oracles_sample sample;
     
     result.push_back(Pair("result","success"));
     if ( myGetTransaction(reforacletxid,oracletx,hashBlock) != 0 && (numvouts=oracletx.vout.size()) > 0 )
@@ -1079,7 +1104,8 @@ UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num)
         if ( DecodeOraclesCreateOpRet(oracletx.vout[numvouts-1].scriptPubKey,name,description,format) == 'C' )
         {
             std::vector<CTransaction> tmp_txs;
-            myGet_mempool_txs(tmp_txs,EVAL_ORACLES,'D');
+            if ( endheight <= 0 ) // mempool samples are newer than any height range
+                myGet_mempool_txs(tmp_txs,EVAL_ORACLES,'D',reforacletxid);
             for (std::vector<CTransaction>::const_iterator it=tmp_txs.begin(); it!=tmp_txs.end(); it++)
             {
                 const CTransaction &txmempool = *it;
@@ -1101,28 +1127,28 @@ UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num)
                     }
                 }
             }
-            SetCCtxids(txids,batonaddr,true,EVAL_ORACLES,reforacletxid,'D');
-            if (txids.size()>0)
+            // the address index is sorted by height, so a height range is a seek and the newest samples are at the end
+            SetCCtxids(addressIndex,batonaddr,true,startheight,endheight);
+            for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_reverse_iterator it=addressIndex.rbegin(); it!=addressIndex.rend(); it++)
             {
-                for (std::vector<uint256>::const_iterator it=txids.end()-1; it!=txids.begin(); it--)
+                txid = it->first.txhash;
+                if ( it->second < 0 || (startheight > 0 && it->first.blockHeight < startheight) || (endheight > 0 && it->first.blockHeight > endheight) )
+                    continue;
+                if ( it->first.index != 1 ) // the data tx marker, which every sample has
+                    continue;
+                if ( GetOraclesSample(txid,sample) != 0 && sample.funcid == 'D' && sample.markervalue == CC_MARKER_VALUE && reforacletxid == sample.oracletxid )
                 {
-                    txid=*it;
-                    if (myGetTransaction(txid,tx,hashBlock) != 0 && (numvouts=tx.vout.size()) > 0 )
+                    if ( (formatstr= (char *)format.c_str()) == 0 )
+                        formatstr = (char *)"";
+                    UniValue a(UniValue::VOBJ);
+                    a.push_back(Pair("txid",txid.GetHex()));
+                    a.push_back(Pair("height",(int64_t)it->first.blockHeight));
+                    a.push_back(Pair("data",OracleFormat((uint8_t *)sample.data.data(),(int32_t)sample.data.size(),formatstr,(int32_t)format.size())));                            
+                    b.push_back(a);
+                    if ( ++n >= num && num != 0)
                     {
-                        if ( tx.vout[1].nValue==CC_MARKER_VALUE && DecodeOraclesData(tx.vout[numvouts-1].scriptPubKey,oracletxid,btxid,pk,data) == 'D' && reforacletxid == oracletxid )
-                        {
-                            if ( (formatstr= (char *)format.c_str()) == 0 )
-                                formatstr = (char *)"";
-                            UniValue a(UniValue::VOBJ);
-                            a.push_back(Pair("txid",txid.GetHex()));
-                            a.push_back(Pair("data",OracleFormat((uint8_t *)data.data(),(int32_t)data.size(),formatstr,(int32_t)format.size())));                            
-                            b.push_back(a);
-                            if ( ++n >= num && num != 0)
-                            {
-                                result.push_back(Pair("samples",b));
-                                return(result);
-                            }
-                        }
+                        result.push_back(Pair("samples",b));
+                        return(result);
                     }
                 }
             }
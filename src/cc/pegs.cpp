@@ -103,7 +103,7 @@ extern uint8_t DecodeGatewaysBindOpRet(char *depositaddr,const CScript &scriptPu
 extern int64_t GetTokenBalance(CPubKey pk, uint256 tokenid);
 extern int32_t komodo_currentheight();
 extern int32_t prices_syntheticvec(std::vector<uint16_t> &vec, std::vector<std::string> synthetic);
-extern int64_t prices_syntheticprice(std::vector<uint16_t> vec, int32_t height, int32_t minmax, int16_t leverage);
+extern int64_t prices_syntheticprice(const std::vector<uint16_t> &vec, int32_t height, int32_t minmax, int16_t leverage);
 
 CScript EncodePegsCreateOpRet(std::vector<uint256> bindtxids)
 {
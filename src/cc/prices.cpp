@@ -132,7 +132,7 @@ typedef struct TotalFund {
 
 } TotalFund;
 
-int32_t prices_syntheticprofits(int64_t &costbasis, int32_t firstheight, int32_t height, int16_t leverage, std::vector<uint16_t> vec, int64_t positionsize, int64_t &profits, int64_t &outprice);
+int32_t prices_syntheticprofits(int64_t &costbasis, int32_t firstheight, int32_t height, int16_t leverage, const std::vector<uint16_t> &vec, int64_t positionsize, int64_t &profits, int64_t &outprice);
 static bool prices_isacceptableamount(const std::vector<uint16_t> &vecparsed, int64_t amount, int16_t leverage);
 
 // helpers:
@@ -965,37 +965,149 @@ int32_t prices_syntheticvec(std::vector<uint16_t> &vec, std::vector<std::string>
     return(0);
 }
 
-// calculates price for synthetic expression
-int64_t prices_syntheticprice(std::vector<uint16_t> vec, int32_t height, int32_t minmax, int16_t leverage)
+// 128 bit fixed width arithmetic for synthetic prices, giving the same results as the GMP code it replaced.
+// Operands are int64_t stack values and SATOSHIDEN, so every product fits in 128 bits except the second one
+// of "***", which is computed in three 64 bit limbs instead.
+typedef __int128 prices_int128_t;
+
+// what mpz_get_si() returns for a value with this sign and these low 64 bits of its magnitude
+static int64_t prices_get_si(bool negative, uint64_t low)
 {
-    int32_t i, value, errcode, depth, retval = -1;
-    uint16_t opcode;
-    int64_t *pricedata, pricestack[4], a, b, c;
+    if (!negative)
+        return (int64_t)(low & std::numeric_limits<int64_t>::max());
+    return -1 - (int64_t)((low - 1) & std::numeric_limits<int64_t>::max());
+}
 
-    mpz_t mpzTotalPrice, mpzPriceValue, mpzDen, mpzA, mpzB, mpzC, mpzResult;
+static int64_t prices_get_si(prices_int128_t x)
+{
+    return x < 0 ? prices_get_si(true, (uint64_t)-x) : prices_get_si(false, (uint64_t)x);
+}
 
-    mpz_init(mpzTotalPrice);
-    mpz_init(mpzPriceValue);
-    mpz_init(mpzDen);
+// (a * c) / SATOSHIDEN truncated. Returns false if the quotient exceeds INT64_MAX,
+// otherwise sets value to what mpz_get_si() returned for it
+static bool prices_muldiv_get_si(prices_int128_t a, int64_t c, int64_t &value)
+{
+    typedef unsigned __int128 uint128_t;
+    bool negative = (a < 0) != (c < 0);
+    uint128_t ua = a < 0 ? -(uint128_t)a : (uint128_t)a;
+    uint128_t uc = c < 0 ? -(uint128_t)c : (uint128_t)c;
+    uint128_t lo = (uint64_t)ua * uc;
+    uint128_t hi = (ua >> 64) * uc + (lo >> 64);
+    uint64_t limbs[3] = { (uint64_t)(hi >> 64), (uint64_t)hi, (uint64_t)lo };
+    uint128_t rem = 0;
+    bool big = false;
+
+    for (int32_t i = 0; i < 3; i++)  // long division of the 192 bit product, high limb first
+    {
+        uint128_t x = (rem << 64) | limbs[i];
+        limbs[i] = (uint64_t)(x / SATOSHIDEN);
+        rem = x % SATOSHIDEN;
+        if (i < 2 && limbs[i] != 0)
+            big = true;
+    }
+    if (limbs[2] == 0 && !big)
+        negative = false;
+    if (!negative && (big || limbs[2] > (uint64_t)std::numeric_limits<int64_t>::max()))
+        return false;
+    value = prices_get_si(negative, limbs[2]);
+    return true;
+}
 
-    mpz_init(mpzA);
-    mpz_init(mpzB);
-    mpz_init(mpzC);
-    mpz_init(mpzResult);
+// applies an operator of a synthetic expression to the top of pricestack
+// returns 0 or the error code of prices_syntheticprice
+int32_t prices_syntheticop(uint16_t opcode, int64_t *pricestack, int32_t &depth)
+{
+    int64_t a, b, c;
+    prices_int128_t result;
+
+    switch (opcode & KOMODO_PRICEMASK)
+    {
+    case PRICES_MULT:   // "*"
+        if (depth < 2)
+            return -3;
+        b = pricestack[--depth];
+        a = pricestack[--depth];
+        result = ((prices_int128_t)a * b) / SATOSHIDEN;
+        break;
+
+    case PRICES_DIV:    // "/"
+        if (depth < 2)
+            return -4;
+        b = pricestack[--depth];
+        a = pricestack[--depth];
+        result = ((prices_int128_t)a * SATOSHIDEN) / b;
+        break;
+
+    case PRICES_INV:    // "!"
+        if (depth < 1)
+            return -5;
+        a = pricestack[--depth];
+        result = ((prices_int128_t)SATOSHIDEN * SATOSHIDEN) / a;
+        break;
+
+    case PRICES_MDD:    // "*//"
+        if (depth < 3)
+            return -6;
+        c = pricestack[--depth];
+        b = pricestack[--depth];
+        a = pricestack[--depth];
+        result = (((((prices_int128_t)a * SATOSHIDEN) / b) * SATOSHIDEN) / c);
+        break;
+
+    case PRICES_MMD:    // "**/"
+        if (depth < 3)
+            return -7;
+        c = pricestack[--depth];
+        b = pricestack[--depth];
+        a = pricestack[--depth];
+        result = ((prices_int128_t)a * b) / c;
+        break;
+
+    case PRICES_MMM:    // "***"
+        if (depth < 3)
+            return -8;
+        c = pricestack[--depth];
+        b = pricestack[--depth];
+        a = pricestack[--depth];
+        if (!prices_muldiv_get_si(((prices_int128_t)a * b) / SATOSHIDEN, c, pricestack[depth++]))
+            return -13;
+        return 0;
+
+    case PRICES_DDD:    // "///"
+        if (depth < 3)
+            return -9;
+        c = pricestack[--depth];
+        b = pricestack[--depth];
+        a = pricestack[--depth];
+        result = (((((((prices_int128_t)SATOSHIDEN * SATOSHIDEN) / a) * SATOSHIDEN) / b) * SATOSHIDEN) / c);
+        break;
+
+    default:
+        return -10;
+    }
+
+    pricestack[depth++] = prices_get_si(result);
+    if (result > std::numeric_limits<int64_t>::max())   // overflow
+        return -13;
+    return 0;
+}
+
+// calculates price for synthetic expression
+int64_t prices_syntheticprice(const std::vector<uint16_t> &vec, int32_t height, int32_t minmax, int16_t leverage)
+{
+    int32_t i, value, errcode, depth;
+    uint16_t opcode;
+    int64_t pricedata[PRICES_MAXDATAPOINTS], pricestack[4];
+    prices_int128_t totalprice, den;
 
-    pricedata = (int64_t *)calloc(sizeof(*pricedata) * 3, 1 + PRICES_DAYWINDOW * 2 + PRICES_SMOOTHWIDTH);
     depth = errcode = 0;
-    mpz_set_si(mpzTotalPrice, 0);
-    mpz_set_si(mpzDen, 0);
+    totalprice = den = 0;
 
     for (i = 0; i < vec.size(); i++)
     {
         opcode = vec[i];
         value = (opcode & (KOMODO_MAXPRICES - 1));   // index or weight 
 
-        mpz_set_ui(mpzResult, 0);  // clear result to test overflow (see below)
-
-        //std::cerr << "prices_syntheticprice" << " i=" << i << " mpzTotalPrice=" << mpz_get_si(mpzTotalPrice) << " value=" << value << " depth=" << depth <<  " opcode&KOMODO_PRICEMASK=" << (opcode & KOMODO_PRICEMASK) <<std::endl;
         switch (opcode & KOMODO_PRICEMASK)
         {
         case 0: // indices 
@@ -1028,176 +1140,26 @@ int64_t prices_syntheticprice(std::vector<uint16_t> vec, int32_t height, int32_t
         case PRICES_WEIGHT: // multiply by weight and consume top of stack by updating price
             if (depth == 1) {
                 depth--;
-                // price += pricestack[0] * value;
-                mpz_set_si(mpzPriceValue, pricestack[0]);
-                mpz_mul_si(mpzPriceValue, mpzPriceValue, value);
-                mpz_add(mpzTotalPrice, mpzTotalPrice, mpzPriceValue);              // accumulate weight's value  
-
-                // den += value; 
-                mpz_add_ui(mpzDen, mpzDen, (uint64_t)value);              // accumulate weight's value  
+                totalprice += (prices_int128_t)pricestack[0] * value;   // accumulate weight's value
+                den += value;
             }
             else
                 errcode = -2;
             break;
 
-        case PRICES_MULT:   // "*"
-            if (depth >= 2) {
-                b = pricestack[--depth];
-                a = pricestack[--depth];
-                // pricestack[depth++] = (a * b) / SATOSHIDEN;
-                mpz_set_si(mpzA, a);
-                mpz_set_si(mpzB, b);
-                mpz_mul(mpzResult, mpzA, mpzB);
-                mpz_tdiv_q_ui(mpzResult, mpzResult, SATOSHIDEN);
-                pricestack[depth++] = mpz_get_si(mpzResult);
-
-            }
-            else
-                errcode = -3;
-            break;
-
-        case PRICES_DIV:    // "/"
-            if (depth >= 2) {
-                b = pricestack[--depth];
-                a = pricestack[--depth];
-                // pricestack[depth++] = (a * SATOSHIDEN) / b;
-                mpz_set_si(mpzA, a);
-                mpz_set_si(mpzB, b);
-                mpz_mul_ui(mpzResult, mpzA, SATOSHIDEN);
-                mpz_tdiv_q(mpzResult, mpzResult, mpzB);                 
-                pricestack[depth++] = mpz_get_si(mpzResult);
-            }
-            else
-                errcode = -4;
-            break;
-
-        case PRICES_INV:    // "!"
-            if (depth >= 1) {
-                a = pricestack[--depth];
-                // pricestack[depth++] = (SATOSHIDEN * SATOSHIDEN) / a;
-                mpz_set_si(mpzA, a);
-                mpz_set_ui(mpzResult, SATOSHIDEN);
-                mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);           
-                mpz_tdiv_q(mpzResult, mpzResult, mpzA);                 
-                pricestack[depth++] = mpz_get_si(mpzResult);
-            }
-            else
-                errcode = -5;
-            break;
-
-        case PRICES_MDD:    // "*//"
-            if (depth >= 3) {
-                c = pricestack[--depth];
-                b = pricestack[--depth];
-                a = pricestack[--depth];
-                // pricestack[depth++] = (((a * SATOSHIDEN) / b) * SATOSHIDEN) / c;
-                mpz_set_si(mpzA, a);
-                mpz_set_si(mpzB, b);
-                mpz_set_si(mpzC, c);
-                mpz_mul_ui(mpzResult, mpzA, SATOSHIDEN);
-                mpz_tdiv_q(mpzResult, mpzResult, mpzB);                 
-                mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);
-                mpz_tdiv_q(mpzResult, mpzResult, mpzC);
-                pricestack[depth++] = mpz_get_si(mpzResult);
-            }
-            else
-                errcode = -6;
-            break;
-
-        case PRICES_MMD:    // "**/"
-            if (depth >= 3) {
-                c = pricestack[--depth];
-                b = pricestack[--depth];
-                a = pricestack[--depth];
-                // pricestack[depth++] = (a * b) / c;
-                mpz_set_si(mpzA, a);
-                mpz_set_si(mpzB, b);
-                mpz_set_si(mpzC, c);
-                mpz_mul(mpzResult, mpzA, mpzB);
-                mpz_tdiv_q(mpzResult, mpzResult, mpzC);
-                pricestack[depth++] = mpz_get_si(mpzResult);
-            }
-            else
-                errcode = -7;
-            break;
-
-        case PRICES_MMM:    // "***"
-            if (depth >= 3) {
-                c = pricestack[--depth];
-                b = pricestack[--depth];
-                a = pricestack[--depth];
-                // pricestack[depth++] = (((a * b) / SATOSHIDEN ) * c) / SATOSHIDEN;
-                mpz_set_si(mpzA, a);
-                mpz_set_si(mpzB, b);
-                mpz_set_si(mpzC, c);
-                mpz_mul(mpzResult, mpzA, mpzB);
-                mpz_tdiv_q_ui(mpzResult, mpzResult, SATOSHIDEN);
-                mpz_mul(mpzResult, mpzResult, mpzC);
-                mpz_tdiv_q_ui(mpzResult, mpzResult, SATOSHIDEN);
-                pricestack[depth++] = mpz_get_si(mpzResult);
-            }
-            else
-                errcode = -8;
-            break;
-                
-        case PRICES_DDD:    // "///"
-            if (depth >= 3) {
-                c = pricestack[--depth];
-                b = pricestack[--depth];
-                a = pricestack[--depth];
-                //pricestack[depth++] = (((((SATOSHIDEN * SATOSHIDEN) / a) * SATOSHIDEN) / b) * SATOSHIDEN) / c;
-                mpz_set_si(mpzA, a);
-                mpz_set_si(mpzB, b);
-                mpz_set_si(mpzC, c);
-                mpz_set_ui(mpzResult, SATOSHIDEN);
-                mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);
-                mpz_tdiv_q(mpzResult, mpzResult, mpzA);
-                mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);
-                mpz_tdiv_q(mpzResult, mpzResult, mpzB);
-                mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);
-                mpz_tdiv_q(mpzResult, mpzResult, mpzC);
-                pricestack[depth++] = mpz_get_si(mpzResult);
-            }
-            else
-                errcode = -9;
-            break;
-
         default:
-            errcode = -10;
-            break;
-        }
-
- //       std::cerr << "prices_syntheticprice test mpzResult=" << mpz_get_si(mpzResult) << std::endl;
-        // check overflow:
-        if (mpz_cmp_si(mpzResult, std::numeric_limits<int64_t>::max()) > 0) {
-            errcode = -13;
+            errcode = prices_syntheticop(opcode, pricestack, depth);
             break;
         }
 
         if (errcode != 0)
             break;
-
- //       if( depth > 0 )
- //           std::cerr << "prices_syntheticprice top pricestack[depth-1=" << depth-1 << "]=" << pricestack[depth-1] << std::endl;
- //       else
- //           std::cerr << "prices_syntheticprice pricestack empty" << std::endl;
-
     }
-    free(pricedata);
-    mpz_clear(mpzResult);
-    mpz_clear(mpzA);
-    mpz_clear(mpzB);
-    mpz_clear(mpzC);
 
-    if( mpz_get_si(mpzDen) != 0 )
-        mpz_tdiv_q(mpzTotalPrice, mpzTotalPrice, mpzDen);   // price / den
+    if (den != 0)
+        totalprice /= den;   // price / den
     
-    int64_t den = mpz_get_si(mpzDen);
-    int64_t priceIndex = mpz_get_si(mpzTotalPrice);
-
-    mpz_clear(mpzDen);
-    mpz_clear(mpzTotalPrice);
-    mpz_clear(mpzPriceValue);
+    int64_t priceIndex = prices_get_si(totalprice);
 
     if (errcode != 0) 
         std::cerr << "prices_syntheticprice errcode in switch=" << errcode << std::endl;
@@ -1233,7 +1195,7 @@ int64_t prices_syntheticprice(std::vector<uint16_t> vec, int32_t height, int32_t
 }
 
 // calculates costbasis and profit/loss for the bet
-int32_t prices_syntheticprofits(int64_t &costbasis, int32_t firstheight, int32_t height, int16_t leverage, std::vector<uint16_t> vec, int64_t positionsize,  int64_t &profits, int64_t &outprice)
+int32_t prices_syntheticprofits(int64_t &costbasis, int32_t firstheight, int32_t height, int16_t leverage, const std::vector<uint16_t> &vec, int64_t positionsize,  int64_t &profits, int64_t &outprice)
 {
     int64_t price;
 #ifndef TESTMODE
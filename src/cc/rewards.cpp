@@ -343,15 +343,49 @@ bool RewardsValidate(struct CCcontract_info *cp,Eval* eval,const CTransaction &t
     return(true);
 }
 
+// decoded opret and outputs of rewards txs by txid. A tx cant change under its txid, so entries never go stale
+// and the unspent index still decides what is spendable
+struct rewards_txinfo { uint8_t funcid; uint64_t sbits; uint256 fundingtxid; std::vector<CTxOut> vout; };
+static CCBoundedCache<uint256,struct rewards_txinfo> rewardsTxCache(100000);
+
+static int32_t GetRewardsTxInfo(uint256 txid,struct rewards_txinfo &info)
+{
+    CTransaction tx; uint256 hashBlock;
+    if ( rewardsTxCache.Get(txid,info) )
+        return(1);
+    if ( myGetTransaction(txid,tx,hashBlock) == 0 || tx.vout.size() == 0 )
+        return(0);
+    info.sbits = 0;
+    info.fundingtxid = zeroid;
+    info.funcid = DecodeRewardsOpRet(txid,tx.vout[tx.vout.size()-1].scriptPubKey,info.sbits,info.fundingtxid);
+    info.vout = tx.vout;
+    rewardsTxCache.Add(txid,info);
+    return(1);
+}
+
+// IsRewardsvout() for a decoded tx whose opret already matched the plan
+static int64_t IsRewardsTxInfovout(struct CCcontract_info *cp,const struct rewards_txinfo &info,int32_t v)
+{
+    char destaddr[64];
+    if ( info.funcid != 0 && v < info.vout.size() && info.vout[v].scriptPubKey.IsPayToCryptoCondition() != 0 )
+    {
+        if ( Getscriptaddress(destaddr,info.vout[v].scriptPubKey) > 0 && strcmp(destaddr,cp->unspendableCCaddr) == 0 )
+            return(info.vout[v].nValue);
+    }
+    return(0);
+}
+
 static uint64_t myIs_unlockedtx_inmempool(uint256 &txid,int32_t &vout,uint64_t refsbits,uint256 reffundingtxid,uint64_t needed)
 {
-    uint8_t funcid; uint64_t sbits,nValue; uint256 fundingtxid; char str[65];
+    uint8_t funcid; uint64_t sbits,nValue; uint256 fundingtxid; char str[65]; std::vector<CTransaction> txs;
     memset(&txid,0,sizeof(txid));
     vout = -1;
     nValue = 0;
-    BOOST_FOREACH(const CTxMemPoolEntry &e,mempool.mapTx)
+    // only the 'U' txs of the mempool CC index, rather than the whole mempool
+    mempool.getCCTransactions(txs,EVAL_REWARDS,'U');
+    for (std::vector<CTransaction>::const_iterator it=txs.begin(); it!=txs.end(); it++)
     {
-        const CTransaction &tx = e.GetTx();
+        const CTransaction &tx = *it;
         if ( tx.vout.size() > 0 && tx.vout[0].nValue >= needed )
         {
             const uint256 &hash = tx.GetHash();
@@ -374,7 +408,7 @@ static uint64_t myIs_unlockedtx_inmempool(uint256 &txid,int32_t &vout,uint64_t r
 // 'L' vs 'F' and 'A'
 int64_t AddRewardsInputs(CScript &scriptPubKey,uint64_t maxseconds,struct CCcontract_info *cp,CMutableTransaction &mtx,CPubKey pk,int64_t total,int32_t maxinputs,uint64_t refsbits,uint256 reffundingtxid)
 {
-    char coinaddr[64],str[65]; uint64_t threshold,sbits,nValue,totalinputs = 0; uint256 txid,hashBlock,fundingtxid; CTransaction tx; int32_t numblocks,j,vout,n = 0; uint8_t funcid;
+    char coinaddr[64],str[65]; uint64_t threshold,sbits,nValue,totalinputs = 0; uint256 txid,fundingtxid; struct rewards_txinfo info; int32_t numblocks,j,vout,n = 0; uint8_t funcid;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
     GetCCaddress(cp,coinaddr,pk);
     SetCCunspents(unspentOutputs,coinaddr,true);
@@ -395,10 +429,12 @@ int64_t AddRewardsInputs(CScript &scriptPubKey,uint64_t maxseconds,struct CCcont
                 break;
         if ( j != mtx.vin.size() )
             continue;
-        if ( myGetTransaction(txid,tx,hashBlock) != 0 && tx.vout.size() > 0 && tx.vout[vout].scriptPubKey.IsPayToCryptoCondition() != 0 && myIsutxo_spentinmempool(ignoretxid,ignorevin,txid,vout) == 0 )
+        if ( GetRewardsTxInfo(txid,info) != 0 && vout < info.vout.size() && info.vout[vout].scriptPubKey.IsPayToCryptoCondition() != 0 && myIsutxo_spentinmempool(ignoretxid,ignorevin,txid,vout) == 0 )
         {
-            if ( (funcid= DecodeRewardsOpRet(txid,tx.vout[tx.vout.size()-1].scriptPubKey,sbits,fundingtxid)) != 0 )
+            if ( (funcid= info.funcid) != 0 )
             {
+                sbits = info.sbits;
+                fundingtxid = info.fundingtxid;
                 if ( sbits != refsbits || fundingtxid != reffundingtxid )
                     continue;
                 if ( maxseconds == 0 && funcid != 'F' && funcid != 'A' && funcid != 'U' )
@@ -408,11 +444,11 @@ int64_t AddRewardsInputs(CScript &scriptPubKey,uint64_t maxseconds,struct CCcont
                     if ( CCduration(numblocks,txid) < maxseconds )
                         continue;
                 }
-                fprintf(stderr,"maxseconds.%d (%c) %.8f %.8f\n",(int32_t)maxseconds,funcid,(double)tx.vout[vout].nValue/COIN,(double)it->second.satoshis/COIN);
+                fprintf(stderr,"maxseconds.%d (%c) %.8f %.8f\n",(int32_t)maxseconds,funcid,(double)info.vout[vout].nValue/COIN,(double)it->second.satoshis/COIN);
                 if ( total != 0 && maxinputs != 0 )
                 {
                     if ( maxseconds != 0 )
-                        scriptPubKey = tx.vout[1].scriptPubKey;
+                        scriptPubKey = info.vout[1].scriptPubKey;
                     mtx.vin.push_back(CTxIn(txid,vout,CScript()));
                 }
                 totalinputs += it->second.satoshis;
@@ -438,7 +474,7 @@ int64_t AddRewardsInputs(CScript &scriptPubKey,uint64_t maxseconds,struct CCcont
 
 int64_t RewardsPlanFunds(uint64_t &lockedfunds,uint64_t refsbits,struct CCcontract_info *cp,CPubKey pk,uint256 reffundingtxid)
 {
-    char coinaddr[64]; uint64_t sbits; int64_t nValue,totalinputs = 0; uint256 txid,hashBlock,fundingtxid; CTransaction tx; int32_t vout; uint8_t funcid;
+    char coinaddr[64]; uint64_t sbits; int64_t nValue,totalinputs = 0; uint256 txid,fundingtxid; struct rewards_txinfo info; int32_t vout; uint8_t funcid;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
     lockedfunds = 0;
     GetCCaddress(cp,coinaddr,pk);
@@ -447,13 +483,15 @@ int64_t RewardsPlanFunds(uint64_t &lockedfunds,uint64_t refsbits,struct CCcontra
     {
         txid = it->first.txhash;
         vout = (int32_t)it->first.index;
-        if ( myGetTransaction(txid,tx,hashBlock) != 0 && tx.vout[vout].scriptPubKey.IsPayToCryptoCondition() != 0 )
+        if ( GetRewardsTxInfo(txid,info) != 0 && vout < info.vout.size() && info.vout[vout].scriptPubKey.IsPayToCryptoCondition() != 0 )
         {
-            if ( (funcid= DecodeRewardsOpRet(txid,tx.vout[tx.vout.size()-1].scriptPubKey,sbits,fundingtxid)) == 'F' || funcid == 'A' || funcid == 'U' || funcid == 'L' )
+            sbits = info.sbits;
+            fundingtxid = info.fundingtxid;
+            if ( (funcid= info.funcid) == 'F' || funcid == 'A' || funcid == 'U' || funcid == 'L' )
             {
                 if ( refsbits == sbits && (funcid == 'F' && reffundingtxid == txid) || reffundingtxid == fundingtxid )
                 {
-                    if ( (nValue= IsRewardsvout(cp,tx,vout,sbits,fundingtxid)) > 0 )
+                    if ( (nValue= IsRewardsTxInfovout(cp,info,vout)) > 0 )
                     {
                         if ( funcid == 'L' )
                             lockedfunds += nValue;
@@ -461,7 +499,7 @@ int64_t RewardsPlanFunds(uint64_t &lockedfunds,uint64_t refsbits,struct CCcontra
                     }
                     else fprintf(stderr,"refsbits.%llx sbits.%llx nValue %.8f\n",(long long)refsbits,(long long)sbits,(double)nValue/COIN);
                 } //else fprintf(stderr,"else case\n");
-            } else fprintf(stderr,"funcid.%d %c skipped %.8f\n",funcid,funcid,(double)tx.vout[vout].nValue/COIN);
+            } else fprintf(stderr,"funcid.%d %c skipped %.8f\n",funcid,funcid,(double)info.vout[vout].nValue/COIN);
         }
     }
     return(totalinputs);
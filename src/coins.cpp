@@ -21,6 +21,7 @@
 
 #include "memusage.h"
 #include "random.h"
+#include "streams.h"
 #include "version.h"
 #include "policy/fees.h"
 #include "komodo_defs.h"
@@ -75,6 +76,8 @@ bool CCoinsView::BatchWrite(CCoinsMap &mapCoins,
                             CNullifiersMap &mapSproutNullifiers,
                             CNullifiersMap &mapSaplingNullifiers) { return false; }
 bool CCoinsView::GetStats(CCoinsStats &stats) const { return false; }
+bool CCoinsView::GetUtxoStats(CUtxoStats &stats) const { return false; }
+CCoinsView *CCoinsView::CreateSnapshotView() const { return NULL; }
 
 
 CCoinsViewBacked::CCoinsViewBacked(CCoinsView *viewIn) : base(viewIn) { }
@@ -96,6 +99,8 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins,
                                   CNullifiersMap &mapSproutNullifiers,
                                   CNullifiersMap &mapSaplingNullifiers) { return base->BatchWrite(mapCoins, hashBlock, hashSproutAnchor, hashSaplingAnchor, mapSproutAnchors, mapSaplingAnchors, mapSproutNullifiers, mapSaplingNullifiers); }
 bool CCoinsViewBacked::GetStats(CCoinsStats &stats) const { return base->GetStats(stats); }
+bool CCoinsViewBacked::GetUtxoStats(CUtxoStats &stats) const { return base->GetUtxoStats(stats); }
+CCoinsView *CCoinsViewBacked::CreateSnapshotView() const { return base->CreateSnapshotView(); }
 
 CCoinsKeyHasher::CCoinsKeyHasher() : salt(GetRandHash()) {}
 
@@ -554,6 +559,43 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+void CUtxoStats::ApplyCoins(const uint256 &txid, const CCoins &coins, bool fAdd) {
+    if (coins.IsPruned())
+        return;
+    int64_t sign = fAdd ? 1 : -1;
+    nTransactions += sign;
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    for (unsigned int i = 0; i < coins.vout.size(); i++) {
+        const CTxOut &out = coins.vout[i];
+        if (out.IsNull())
+            continue;
+        // One set element per output: its outpoint, when and how it was
+        // created, and the output itself
+        ss.clear();
+        ss << txid << VARINT(i) << VARINT(coins.nHeight * 2 + (coins.fCoinBase ? 1 : 0)) << out;
+        if (fAdd)
+            muhash.Insert((const unsigned char*)&ss[0], ss.size());
+        else
+            muhash.Remove((const unsigned char*)&ss[0], ss.size());
+        nTransactionOutputs += sign;
+        nTotalAmount += sign * out.nValue;
+        nBogoSize += sign * (int64_t)(32 + 4 + 4 + 8 + 2 + out.scriptPubKey.size());
+    }
+}
+
+void CCoinsViewCache::UpdateUtxoStats(CUtxoStats &stats) const {
+    for (CCoinsMap::const_iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY))
+            continue;
+        if (!(it->second.flags & CCoinsCacheEntry::FRESH)) {
+            CCoins old;
+            if (base->GetCoins(it->first, old))
+                stats.RemoveCoins(it->first, old);
+        }
+        stats.AddCoins(it->first, it->second.coins);
+    }
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
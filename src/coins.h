@@ -25,6 +25,7 @@
 
 #include "compressor.h"
 #include "core_memusage.h"
+#include "crypto/muhash.h"
 #include "memusage.h"
 #include "serialize.h"
 #include "uint256.h"
@@ -367,6 +368,55 @@ struct CCoinsStats
     CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
 };
 
+/**
+ * UTXO set statistics that can be kept up to date one block at a time
+ * (-utxostatsindex). Unlike CCoinsStats::hashSerialized, the MuHash of the
+ * set does not depend on the order of the coins, so adding and removing
+ * outputs as blocks are connected gives the same result as a full scan.
+ */
+struct CUtxoStats
+{
+    uint256 hashBlock;
+    int nHeight;
+    uint64_t nTransactions;
+    uint64_t nTransactionOutputs;
+    //! rough size of the set: 50 bytes plus the script size per output
+    uint64_t nBogoSize;
+    CAmount nTotalAmount;
+    MuHash3072 muhash;
+
+    CUtxoStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nBogoSize(0), nTotalAmount(0) {}
+
+    //! Add or remove all unspent outputs of a CCoins entry
+    void AddCoins(const uint256 &txid, const CCoins &coins) { ApplyCoins(txid, coins, true); }
+    void RemoveCoins(const uint256 &txid, const CCoins &coins) { ApplyCoins(txid, coins, false); }
+
+    //! Apply the changes in delta, as collected by CCoinsViewCache::UpdateUtxoStats
+    void Add(const CUtxoStats &delta) {
+        nTransactions += delta.nTransactions;
+        nTransactionOutputs += delta.nTransactionOutputs;
+        nBogoSize += delta.nBogoSize;
+        nTotalAmount += delta.nTotalAmount;
+        muhash *= delta.muhash;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(nTransactions);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nBogoSize);
+        READWRITE(nTotalAmount);
+        READWRITE(muhash);
+    }
+
+private:
+    void ApplyCoins(const uint256 &txid, const CCoins &coins, bool fAdd);
+};
+
 
 /** Abstract view on the open txout dataset. */
 class CCoinsView
@@ -408,6 +458,16 @@ public:
     //! Calculate statistics about the unspent transaction output set
     virtual bool GetStats(CCoinsStats &stats) const;
 
+    //! Calculate the incrementally maintainable statistics of the unspent
+    //! transaction output set with a full scan
+    virtual bool GetUtxoStats(CUtxoStats &stats) const;
+
+    //! Return a new read-only view of the persistent state below this view,
+    //! pinned at the time of the call, or NULL if there is none. Changes
+    //! still held in caches above the database are not part of it, so flush
+    //! them first. The caller owns the returned view.
+    virtual CCoinsView *CreateSnapshotView() const;
+
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() {}
 };
@@ -438,6 +498,8 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    bool GetUtxoStats(CUtxoStats &stats) const;
+    CCoinsView *CreateSnapshotView() const;
 };
 
 
@@ -573,6 +635,13 @@ public:
      */
     bool Flush();
 
+    /**
+     * Apply the coins changes this cache holds over its base view to stats,
+     * so that they describe the state this cache would flush. Used on the
+     * per-block cache in ConnectTip, where the base holds the previous state.
+     */
+    void UpdateUtxoStats(CUtxoStats &stats) const;
+
     //! Calculate the size of the cache (in number of transactions)
     unsigned int GetCacheSize() const;
 
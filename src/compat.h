@@ -108,8 +108,16 @@ typedef u_int SOCKET;
 size_t strnlen( const char *start, size_t max_len);
 #endif // HAVE_DECL_STRNLEN
 
+// On Linux the socket handler waits on epoll and the connect/recv helpers on
+// poll(), so sockets are not limited to FD_SETSIZE.
+#if !defined(_WIN32) && defined(HAVE_SYS_EPOLL_H)
+#define USE_EPOLL
+#include <poll.h>
+#include <sys/epoll.h>
+#endif
+
 bool static inline IsSelectableSocket(SOCKET s) {
-#ifdef _WIN32
+#if defined(_WIN32) || defined(USE_EPOLL)
     return true;
 #else
     return (s < FD_SETSIZE);
@@ -22,6 +22,9 @@
 
 #include "cc/CCinclude.h"
 
+#include <algorithm>
+#include <tuple>
+
 /*
  * The crosschain workflow.
  *
@@ -44,11 +47,74 @@
 
 int NOTARISATION_SCAN_LIMIT_BLOCKS = 1440;
 CBlockIndex *komodo_getblockindex(uint256 hash);
+std::shared_ptr<const std::vector<uint256> > komodo_MoMtree(int32_t height,int32_t MoMdepth);
+
+
+/*
+ * Proof roots already calculated. The scan only looks at blocks at or below kmdHeight, so
+ * the hash of the block at kmdHeight pins the result and entries stay valid across reorgs.
+ */
+struct ProofRootKey
+{
+    std::string symbol;
+    uint32_t ccid;
+    int kmdHeight;
+    uint256 blockHash;
 
+    friend bool operator<(const ProofRootKey& a, const ProofRootKey& b) {
+        return std::tie(a.kmdHeight, a.blockHash, a.ccid, a.symbol) <
+               std::tie(b.kmdHeight, b.blockHash, b.ccid, b.symbol);
+    }
+};
+
+struct ProofRootValue
+{
+    uint256 MoMoM;
+    std::vector<uint256> moms;
+    uint256 destNotarisationTxid;
+};
+
+static const size_t PROOF_ROOT_CACHE_SIZE = 256;
+static CCriticalSection cs_proofRootCache;
+static std::map<ProofRootKey, ProofRootValue> proofRootCache;
+
+static uint256 CalculateProofRootUncached(const char* symbol, uint32_t targetCCid, int kmdHeight,
+        std::vector<uint256> &moms, uint256 &destNotarisationTxid);
 
 /* On KMD */
 uint256 CalculateProofRoot(const char* symbol, uint32_t targetCCid, int kmdHeight,
         std::vector<uint256> &moms, uint256 &destNotarisationTxid)
+{
+    if (targetCCid < 2)
+        return uint256();
+
+    if (kmdHeight < 0 || kmdHeight > chainActive.Height())
+        return uint256();
+
+    ProofRootKey key {symbol, targetCCid, kmdHeight, *chainActive[kmdHeight]->phashBlock};
+    {
+        LOCK(cs_proofRootCache);
+        auto it = proofRootCache.find(key);
+        if (it != proofRootCache.end()) {
+            moms = it->second.moms;
+            destNotarisationTxid = it->second.destNotarisationTxid;
+            return it->second.MoMoM;
+        }
+    }
+
+    uint256 MoMoM = CalculateProofRootUncached(symbol, targetCCid, kmdHeight, moms, destNotarisationTxid);
+    if (!MoMoM.IsNull()) {
+        LOCK(cs_proofRootCache);
+        // Drop the lowest height, which is the least likely to be asked for again
+        if (proofRootCache.size() >= PROOF_ROOT_CACHE_SIZE)
+            proofRootCache.erase(proofRootCache.begin());
+        proofRootCache[key] = ProofRootValue {MoMoM, moms, destNotarisationTxid};
+    }
+    return MoMoM;
+}
+
+static uint256 CalculateProofRootUncached(const char* symbol, uint32_t targetCCid, int kmdHeight,
+        std::vector<uint256> &moms, uint256 &destNotarisationTxid)
 {
     /*
      * Notaries don't wait for confirmation on KMD before performing a backnotarisation,
@@ -192,26 +258,19 @@ TxProof GetCrossChainProof(const uint256 txid, const char* targetSymbol, uint32_
     if (MoMoM.IsNull())
         throw std::runtime_error("No MoMs found");
 
-    // Find index of source MoM in MoMoM
-    int nIndex;
-    for (nIndex=0; nIndex<moms.size(); nIndex++) {
-        if (moms[nIndex] == MoM)
-            goto cont;
-    }
-    throw std::runtime_error("Couldn't find MoM within MoMoM set");
-cont:
+    // Find index of source MoM in MoMoM, the MoMs are sorted
+    std::vector<uint256>::const_iterator itMoM = std::lower_bound(moms.begin(), moms.end(), MoM);
+    if (itMoM == moms.end() || *itMoM != MoM)
+        throw std::runtime_error("Couldn't find MoM within MoMoM set");
+    int nIndex = itMoM - moms.begin();
 
     // Create a branch
     std::vector<uint256> vBranch;
     {
-        CBlock fakeBlock;
-        for (int i=0; i<moms.size(); i++) {
-            CTransaction fakeTx;
-            // first value in CTransaction memory is it's hash
-            memcpy((void*)&fakeTx, moms[i].begin(), 32);
-            fakeBlock.vtx.push_back(fakeTx);
-        }
-        vBranch = fakeBlock.GetMerkleBranch(nIndex);
+        std::vector<uint256> tree;
+        bool fMutated;
+        BuildMerkleTree(&fMutated, moms, tree);
+        vBranch = GetMerkleBranch(nIndex, moms.size(), tree);
     }
 
     // Concatenate branches
@@ -457,14 +516,10 @@ TxProof GetAssetchainProof(uint256 hash,CTransaction burnTx)
 
     // build merkle chain from blocks to MoM
     {
-        std::vector<uint256> leaves, tree;
-        for (int i=0; i<nota.second.MoMDepth; i++) {
-            uint256 mRoot = chainActive[nota.second.height - i]->hashMerkleRoot;
-            leaves.push_back(mRoot);
-        }
-        bool fMutated;
-        BuildMerkleTree(&fMutated, leaves, tree);
-        branch = GetMerkleBranch(nIndex, leaves.size(), tree);
+        std::shared_ptr<const std::vector<uint256> > tree = komodo_MoMtree(nota.second.height, nota.second.MoMDepth);
+        if (tree == nullptr)
+            throw std::runtime_error("Failed merkle block->MoM");
+        branch = GetMerkleBranch(nIndex, nota.second.MoMDepth & 0xffff, *tree);
 
         // Check branch
         uint256 ourResult = SafeCheckMerkleBranch(blockIndex->hashMerkleRoot, branch, nIndex);
@@ -29,6 +29,7 @@ typedef struct CrosschainAuthority {
 } CrosschainAuthority;
 
 int GetSymbolAuthority(const char* symbol);
+bool GetSpentPubkey(const CTxIn &txIn, std::vector<uint8_t> &pubkey);
 bool CheckTxAuthority(const CTransaction &tx, CrosschainAuthority auth);
 
 /* On assetchain */
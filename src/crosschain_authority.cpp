@@ -2,6 +2,7 @@
 #include "crosschain.h"
 #include "notarisationdb.h"
 #include "notaries_staked.h"
+#include "sync.h"
 
 int GetSymbolAuthority(const char* symbol)
 {
@@ -16,26 +17,59 @@ int GetSymbolAuthority(const char* symbol)
 }
 
 
-bool CheckTxAuthority(const CTransaction &tx, CrosschainAuthority auth)
+/*
+ * Pubkeys of the pay to pubkey outputs spent by notarisations. A block's notarisation inputs
+ * are looked up by the notary pay check and again when the notarisations are indexed, and
+ * an outpoint always refers to the same output, so the lookups are shared through here.
+ * Outputs that are not pay to pubkey are kept with an empty pubkey.
+ */
+static const size_t SPENT_PUBKEY_CACHE_SIZE = 20000;
+static CCriticalSection cs_spentPubkeyCache;
+static std::map<COutPoint, std::vector<uint8_t>> spentPubkeyCache;
+
+bool GetSpentPubkey(const CTxIn &txIn, std::vector<uint8_t> &pubkey)
 {
+    {
+        LOCK(cs_spentPubkeyCache);
+        auto it = spentPubkeyCache.find(txIn.prevout);
+        if (it != spentPubkeyCache.end()) {
+            pubkey = it->second;
+            return true;
+        }
+    }
+
     EvalRef eval;
+    CTransaction tx;
+    uint256 hashBlock;
+    if (!eval->GetTxUnconfirmed(txIn.prevout.hash, tx, hashBlock)) return false;
+    if (tx.vout.size() <= txIn.prevout.n) return false;
 
+    pubkey.clear();
+    const CScript &spk = tx.vout[txIn.prevout.n].scriptPubKey;
+    if (spk.size() == 35 && spk[0] == 33 && spk[34] == OP_CHECKSIG)
+        pubkey.assign(spk.begin() + 1, spk.begin() + 34);
+
+    LOCK(cs_spentPubkeyCache);
+    if (spentPubkeyCache.size() >= SPENT_PUBKEY_CACHE_SIZE)
+        spentPubkeyCache.erase(spentPubkeyCache.begin());
+    spentPubkeyCache[txIn.prevout] = pubkey;
+    return true;
+}
+
+
+bool CheckTxAuthority(const CTransaction &tx, CrosschainAuthority auth)
+{
     if (tx.vin.size() < auth.requiredSigs) return false;
 
     uint8_t seen[64] = {0};
+    std::vector<uint8_t> pubkey;
 
     BOOST_FOREACH(const CTxIn &txIn, tx.vin)
     {
         // Get notary pubkey
-        CTransaction tx;
-        uint256 hashBlock;
-        if (!eval->GetTxUnconfirmed(txIn.prevout.hash, tx, hashBlock)) return false;
-        if (tx.vout.size() < txIn.prevout.n) return false;
-        CScript spk = tx.vout[txIn.prevout.n].scriptPubKey;
-        if (spk.size() != 35) return false;
-        const unsigned char *pk = &spk[0];
-        if (pk++[0] != 33) return false;
-        if (pk[33] != OP_CHECKSIG) return false;
+        if (!GetSpentPubkey(txIn, pubkey)) return false;
+        if (pubkey.size() != 33) return false;
+        const unsigned char *pk = &pubkey[0];
 
         // Check it's a notary
         for (int i=0; i<auth.size; i++) {
@@ -0,0 +1,182 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/muhash.h"
+
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#include <limits>
+#include <string.h>
+
+namespace {
+
+typedef unsigned __int128 double_limb_t;
+
+/** 2^3072 - MAX_PRIME_DIFF is the modulus */
+const Num3072::limb_t MAX_PRIME_DIFF = 1103717;
+
+} // namespace
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; i++)
+        limbs[i] = ReadLE64(data + 8 * i);
+    if (IsOverflow())
+        FullReduce();
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (int i = 1; i < LIMBS; i++)
+        limbs[i] = 0;
+}
+
+/** Whether the value is at least the modulus (and below 2^3072). */
+bool Num3072::IsOverflow() const
+{
+    if (limbs[0] <= std::numeric_limits<limb_t>::max() - MAX_PRIME_DIFF)
+        return false;
+    for (int i = 1; i < LIMBS; i++) {
+        if (limbs[i] != std::numeric_limits<limb_t>::max())
+            return false;
+    }
+    return true;
+}
+
+/** Subtract the modulus once, i.e. add MAX_PRIME_DIFF and drop 2^3072. */
+void Num3072::FullReduce()
+{
+    limb_t carry = MAX_PRIME_DIFF;
+    for (int i = 0; i < LIMBS; i++) {
+        double_limb_t cur = (double_limb_t)limbs[i] + carry;
+        limbs[i] = (limb_t)cur;
+        carry = (limb_t)(cur >> 64);
+    }
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    // Schoolbook product into 2 * LIMBS limbs
+    limb_t tmp[2 * LIMBS];
+    memset(tmp, 0, sizeof(tmp));
+    for (int i = 0; i < LIMBS; i++) {
+        limb_t carry = 0;
+        for (int j = 0; j < LIMBS; j++) {
+            double_limb_t cur = (double_limb_t)limbs[i] * a.limbs[j] + tmp[i + j] + carry;
+            tmp[i + j] = (limb_t)cur;
+            carry = (limb_t)(cur >> 64);
+        }
+        tmp[i + LIMBS] = carry;
+    }
+
+    // 2^3072 = MAX_PRIME_DIFF (mod p), so fold the high half into the low one
+    limb_t carry = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        double_limb_t cur = (double_limb_t)tmp[i + LIMBS] * MAX_PRIME_DIFF + tmp[i] + carry;
+        limbs[i] = (limb_t)cur;
+        carry = (limb_t)(cur >> 64);
+    }
+    // ... and what carried out of it, which is small enough that folding the
+    // result of this addition once more cannot overflow again.
+    while (carry != 0) {
+        double_limb_t cur = (double_limb_t)carry * MAX_PRIME_DIFF;
+        carry = 0;
+        for (int i = 0; i < LIMBS; i++) {
+            cur += limbs[i];
+            limbs[i] = (limb_t)cur;
+            cur >>= 64;
+            if (cur == 0)
+                break;
+        }
+        carry = (limb_t)cur;
+    }
+    if (IsOverflow())
+        FullReduce();
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // Fermat's little theorem: a^-1 = a^(p-2) (mod p). The exponent is
+    // 2^3072 - MAX_PRIME_DIFF - 2, all ones except for the lowest limb.
+    const limb_t low = std::numeric_limits<limb_t>::max() - MAX_PRIME_DIFF - 1;
+    Num3072 result;
+    for (int i = LIMBS - 1; i >= 0; i--) {
+        limb_t e = (i == 0) ? low : std::numeric_limits<limb_t>::max();
+        for (int bit = 63; bit >= 0; bit--) {
+            result.Multiply(result);
+            if ((e >> bit) & 1)
+                result.Multiply(*this);
+        }
+    }
+    return result;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    for (int i = 0; i < LIMBS; i++)
+        WriteLE64(out + 8 * i, limbs[i]);
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(hash);
+
+    unsigned char expanded[Num3072::BYTE_SIZE];
+    static_assert(Num3072::BYTE_SIZE % CSHA256::OUTPUT_SIZE == 0, "expansion must fill whole SHA256 outputs");
+    for (unsigned char i = 0; i < Num3072::BYTE_SIZE / CSHA256::OUTPUT_SIZE; i++)
+        CSHA256().Write(hash, sizeof(hash)).Write(&i, 1).Finalize(expanded + CSHA256::OUTPUT_SIZE * i);
+    return Num3072(expanded);
+}
+
+MuHash3072::MuHash3072(const unsigned char* data, size_t len)
+{
+    numerator = ToNum3072(data, len);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+uint256 MuHash3072::Finalize() const
+{
+    Num3072 value = numerator;
+    value.Divide(denominator);
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    value.ToBytes(data);
+
+    uint256 out;
+    CSHA256().Write(data, sizeof(data)).Finalize(out.begin());
+    return out;
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+/** An element of the multiplicative group of integers modulo 2^3072 - 1103717. */
+class Num3072
+{
+public:
+    static const size_t BYTE_SIZE = 384;
+    static const int LIMBS = 48;
+    typedef uint64_t limb_t;
+
+private:
+    limb_t limbs[LIMBS];
+
+    bool IsOverflow() const;
+    void FullReduce();
+
+public:
+    Num3072() { SetToOne(); }
+    //! Interpret BYTE_SIZE little endian bytes, reduced modulo the prime
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    Num3072 GetInverse() const;
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        for (int i = 0; i < LIMBS; i++)
+            READWRITE(limbs[i]);
+        if (ser_action.ForRead() && IsOverflow())
+            FullReduce();
+    }
+};
+
+/**
+ * A rolling hash of a set of byte strings (MuHash3072). Elements are mapped
+ * to Num3072 and multiplied together, so the result does not depend on the
+ * order they are added in and removing an element undoes adding it. This is
+ * what lets the UTXO set hash be kept up to date one block at a time.
+ *
+ * Elements are expanded to 3072 bits by hashing their SHA256 with a counter.
+ * Removed elements are accumulated in a separate denominator, so the costly
+ * inversion only happens in Finalize.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    //! The empty set
+    MuHash3072() {}
+    //! A set containing the single element data
+    MuHash3072(const unsigned char* data, size_t len);
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+
+    //! Union and difference of (multi)sets
+    MuHash3072& operator*=(const MuHash3072& mul);
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    //! Hash of the set, 32 bytes
+    uint256 Finalize() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(numerator);
+        READWRITE(denominator);
+    }
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
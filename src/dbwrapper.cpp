@@ -82,6 +82,20 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+CDBSnapshot::CDBSnapshot(const CDBWrapper &_parent) : parent(_parent)
+{
+    psnapshot = parent.pdb->GetSnapshot();
+    readoptions = parent.readoptions;
+    readoptions.snapshot = psnapshot;
+    iteroptions = parent.iteroptions;
+    iteroptions.snapshot = psnapshot;
+}
+
+CDBSnapshot::~CDBSnapshot()
+{
+    parent.pdb->ReleaseSnapshot(psnapshot);
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
@@ -156,6 +156,8 @@ public:
 
 class CDBWrapper
 {
+    friend class CDBSnapshot;
+
 private:
     //! custom environment this database is using (may be NULL in case of default environment)
     leveldb::Env* penv;
@@ -178,18 +180,8 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
-public:
-    /**
-     * @param[in] path        Location in the filesystem where leveldb data will be stored.
-     * @param[in] nCacheSize  Configures various leveldb cache settings.
-     * @param[in] fMemory     If true, use leveldb's memory environment.
-     * @param[in] fWipe       If true, remove all existing data.
-     */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = false, int maxOpenFiles = 64);
-    ~CDBWrapper();
-
     template <typename K, typename V>
-    bool Read(const K& key, V& value) const
+    bool Read(const leveldb::ReadOptions& options, const K& key, V& value) const
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
@@ -197,7 +189,7 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(options, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -213,16 +205,8 @@ public:
         return true;
     }
 
-    template <typename K, typename V>
-    bool Write(const K& key, const V& value, bool fSync = false)
-    {
-        CDBBatch batch(*this);
-        batch.Write(key, value);
-        return WriteBatch(batch, fSync);
-    }
-
     template <typename K>
-    bool Exists(const K& key) const
+    bool Exists(const leveldb::ReadOptions& options, const K& key) const
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
@@ -230,7 +214,7 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(options, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -240,6 +224,36 @@ public:
         return true;
     }
 
+public:
+    /**
+     * @param[in] path        Location in the filesystem where leveldb data will be stored.
+     * @param[in] nCacheSize  Configures various leveldb cache settings.
+     * @param[in] fMemory     If true, use leveldb's memory environment.
+     * @param[in] fWipe       If true, remove all existing data.
+     */
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = false, int maxOpenFiles = 64);
+    ~CDBWrapper();
+
+    template <typename K, typename V>
+    bool Read(const K& key, V& value) const
+    {
+        return Read(readoptions, key, value);
+    }
+
+    template <typename K, typename V>
+    bool Write(const K& key, const V& value, bool fSync = false)
+    {
+        CDBBatch batch(*this);
+        batch.Write(key, value);
+        return WriteBatch(batch, fSync);
+    }
+
+    template <typename K>
+    bool Exists(const K& key) const
+    {
+        return Exists(readoptions, key);
+    }
+
     template <typename K>
     bool Erase(const K& key, bool fSync = false)
     {
@@ -273,5 +287,46 @@ public:
     bool IsEmpty();
 };
 
+/**
+ * Read-only view of a CDBWrapper pinned at the moment it was created. Writes
+ * committed to the database afterwards are not visible through it, so long
+ * scans see one consistent state without holding any lock of the caller.
+ * The parent must outlive the snapshot.
+ */
+class CDBSnapshot
+{
+private:
+    const CDBWrapper &parent;
+    const leveldb::Snapshot *psnapshot;
+
+    //! parent's read/iterate options with the snapshot set
+    leveldb::ReadOptions readoptions;
+    leveldb::ReadOptions iteroptions;
+
+    CDBSnapshot(const CDBSnapshot&);
+    void operator=(const CDBSnapshot&);
+
+public:
+    CDBSnapshot(const CDBWrapper &_parent);
+    ~CDBSnapshot();
+
+    template <typename K, typename V>
+    bool Read(const K& key, V& value) const
+    {
+        return parent.Read(readoptions, key, value);
+    }
+
+    template <typename K>
+    bool Exists(const K& key) const
+    {
+        return parent.Exists(readoptions, key);
+    }
+
+    CDBIterator *NewIterator() const
+    {
+        return new CDBIterator(parent, parent.pdb->NewIterator(iteroptions));
+    }
+};
+
 #endif // BITCOIN_DBWRAPPER_H
 
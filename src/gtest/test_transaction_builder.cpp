@@ -93,6 +93,81 @@ TEST(TransactionBuilder, Invoke)
     UpdateNetworkUpgradeParameters(Consensus::UPGRADE_OVERWINTER, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
 }
 
+// A transaction is cached as verified only once its spend and output proofs
+// and its binding signature are all valid, so a transaction failing any of
+// them is rejected on every call
+TEST(TransactionBuilder, SaplingProofCacheOnlyStoresValid)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_OVERWINTER, Consensus::NetworkUpgrade::ALWAYS_ACTIVE);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_SAPLING, Consensus::NetworkUpgrade::ALWAYS_ACTIVE);
+    auto consensusParams = Params().GetConsensus();
+
+    CBasicKeyStore keystore;
+    CKey tsk = DecodeSecret(tSecretRegtest);
+    keystore.AddKey(tsk);
+    auto scriptPubKey = GetScriptForDestination(tsk.GetPubKey().GetID());
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = sk.full_viewing_key();
+    auto ivk = fvk.in_viewing_key();
+    auto pk = sk.default_address();
+
+    auto builder1 = TransactionBuilder(consensusParams, 1, &keystore);
+    builder1.AddTransparentInput(COutPoint(), scriptPubKey, 50000);
+    builder1.AddSaplingOutput(fvk.ovk, pk, 40000, {});
+    auto maybe_tx1 = builder1.Build();
+    ASSERT_EQ(static_cast<bool>(maybe_tx1), true);
+    auto tx1 = maybe_tx1.get();
+
+    auto maybe_pt = libzcash::SaplingNotePlaintext::decrypt(
+        tx1.vShieldedOutput[0].encCiphertext, ivk, tx1.vShieldedOutput[0].ephemeralKey, tx1.vShieldedOutput[0].cm);
+    ASSERT_EQ(static_cast<bool>(maybe_pt), true);
+    auto maybe_note = maybe_pt.get().note(ivk);
+    ASSERT_EQ(static_cast<bool>(maybe_note), true);
+    SaplingMerkleTree tree;
+    tree.append(tx1.vShieldedOutput[0].cm);
+
+    auto builder2 = TransactionBuilder(consensusParams, 2);
+    ASSERT_TRUE(builder2.AddSaplingSpend(expsk, maybe_note.get(), tree.root(), tree.witness()));
+    builder2.AddSaplingOutput(fvk.ovk, pk, 25000, {});
+    auto maybe_tx2 = builder2.Build();
+    ASSERT_EQ(static_cast<bool>(maybe_tx2), true);
+    auto tx2 = maybe_tx2.get();
+
+    // Valid, and still valid once answered from the cache
+    for (int i = 0; i < 2; i++) {
+        CValidationState state;
+        EXPECT_TRUE(ContextualCheckTransaction(0, NULL, NULL, tx2, state, 3, 0));
+        EXPECT_EQ(state.GetRejectReason(), "");
+    }
+
+    CMutableTransaction badSpend(tx2);
+    badSpend.vShieldedSpend[0].zkproof[0] ^= 1;
+    CMutableTransaction badOutput(tx2);
+    badOutput.vShieldedOutput[0].zkproof[0] ^= 1;
+    CMutableTransaction badBindingSig(tx2);
+    badBindingSig.bindingSig[0] ^= 1;
+
+    std::vector<std::pair<CTransaction, std::string>> invalid = {
+        { badSpend, "bad-txns-sapling-spend-description-invalid" },
+        { badOutput, "bad-txns-sapling-output-description-invalid" },
+        { badBindingSig, "bad-txns-sapling-binding-signature-invalid" },
+    };
+    for (const auto &item : invalid) {
+        for (int i = 0; i < 2; i++) {
+            CValidationState state;
+            EXPECT_FALSE(ContextualCheckTransaction(0, NULL, NULL, item.first, state, 3, 0));
+            EXPECT_EQ(state.GetRejectReason(), item.second);
+        }
+    }
+
+    // Revert to default
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_SAPLING, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_OVERWINTER, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+}
+
 TEST(TransactionBuilder, ThrowsOnTransparentInputWithoutKeyStore)
 {
     auto consensusParams = Params().GetConsensus();
@@ -794,11 +794,13 @@ int32_t komodo_voutupdate(bool fJustCheck,int32_t *isratificationp,int32_t notar
 
 int32_t gettxout_scriptPubKey(uint8_t *scriptPubKey,int32_t maxsize,uint256 txid,int32_t n);
 
-int32_t komodo_notarycmp(uint8_t *scriptPubKey,int32_t scriptlen,uint8_t pubkeys[64][33],int32_t numnotaries,uint8_t rmd160[20])
+int32_t komodo_notarycmp(uint8_t *scriptPubKey,int32_t scriptlen,uint8_t pubkeys[64][33],int32_t numnotaries,uint8_t rmd160[20],int32_t kmd_season)
 {
     int32_t i;
     if ( scriptlen == 25 && memcmp(&scriptPubKey[3],rmd160,20) == 0 )
         return(0);
+    else if ( scriptlen == 35 && kmd_season != 0 )
+        return(komodo_seasonnotaryid(kmd_season,&scriptPubKey[1]));
     else if ( scriptlen == 35 )
     {
         for (i=0; i<numnotaries; i++)
@@ -819,7 +821,7 @@ int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
     std::vector<int32_t> notarisations;
     uint64_t signedmask,voutmask; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; struct komodo_state *sp;
     uint8_t scriptbuf[10001],pubkeys[64][33],rmd160[20],scriptPubKey[35]; uint256 zero,btctxid,txhash;
-    int32_t i,j,k,numnotaries,notarized,scriptlen,isratification,nid,numvalid,specialtx,notarizedheight,notaryid,len,numvouts,numvins,height,txn_count;
+    int32_t i,j,k,numnotaries,notarized,scriptlen,isratification,nid,numvalid,specialtx,notarizedheight,notaryid,len,numvouts,numvins,height,txn_count,kmd_season,minvalid,scanvins; uint32_t seasontime;
     if ( pindex == 0 )
     {
         fprintf(stderr,"komodo_connectblock null pindex\n");
@@ -849,6 +851,10 @@ int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
     }
     numnotaries = komodo_notaries(pubkeys,pindex->GetHeight(),pindex->GetBlockTime());
     calc_rmd160_sha256(rmd160,pubkeys[0],33);
+    seasontime = (uint32_t)pindex->GetBlockTime();
+    kmd_season = komodo_notaryseason(pindex->GetHeight(),&seasontime);
+    // fewest notary inputs that can make a tx count as notarized below
+    minvalid = (numnotaries/5 + 1 < KOMODO_MINRATIFY) ? numnotaries/5 + 1 : KOMODO_MINRATIFY;
     if ( pindex->GetHeight() > hwmheight )
         hwmheight = pindex->GetHeight();
     else
@@ -866,6 +872,8 @@ int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
         }
     }
     komodo_currentheight_set(chainActive.LastTip()->GetHeight());
+    if ( !fJustCheck )
+        komodo_kvpurge(pindex->GetHeight());
     int transaction = 0;
     if ( pindex != 0 )
     {
@@ -886,13 +894,21 @@ int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
             voutmask = specialtx = notarizedheight = isratification = notarized = 0;
             signedmask = (height < 91400) ? 1 : 0;
             numvins = block.vtx[i].vin.size();
-            for (j=0; j<numvins; j++)
+            // the spent scripts are only needed to tell notarisations apart and to gate opreturns on notary
+            // inputs, so txs without an opreturn and too few inputs to be notarized skip the lookups
+            scanvins = ((int32_t)signedmask + numvins - (i == 0) >= minvalid);
+            for (j=0; j<numvouts && scanvins == 0; j++)
+            {
+                if ( block.vtx[i].vout[j].scriptPubKey.size() > 0 && block.vtx[i].vout[j].scriptPubKey[0] == 0x6a )
+                    scanvins = 1;
+            }
+            for (j=0; j<numvins && scanvins != 0; j++)
             {
                 if ( i == 0 && j == 0 )
                     continue;
                 if ( (scriptlen= gettxout_scriptPubKey(scriptPubKey,sizeof(scriptPubKey),block.vtx[i].vin[j].prevout.hash,block.vtx[i].vin[j].prevout.n)) > 0 )
                 {
-                    if ( (k= komodo_notarycmp(scriptPubKey,scriptlen,pubkeys,numnotaries,rmd160)) >= 0 )
+                    if ( (k= komodo_notarycmp(scriptPubKey,scriptlen,pubkeys,numnotaries,rmd160,kmd_season)) >= 0 )
                         signedmask |= (1LL << k);
                     else if ( 0 && numvins >= 17 )
                     {
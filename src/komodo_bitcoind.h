@@ -2058,21 +2058,23 @@ uint64_t komodo_notarypay(CMutableTransaction &txNew, std::vector<int8_t> &Notar
     return(total);
 }
 
+bool GetSpentPubkey(const CTxIn &txIn, std::vector<uint8_t> &pubkey);
+
 bool GetNotarisationNotaries(uint8_t notarypubkeys[64][33], int8_t &numNN, const std::vector<CTxIn> &vin, std::vector<int8_t> &NotarisationNotaries)
 {
-    uint8_t *script; int32_t scriptlen;
+    std::vector<uint8_t> pubkey;
     if ( notarypubkeys[0][0] == 0 )
         return false;
     BOOST_FOREACH(const CTxIn& txin, vin)
     {
-        uint256 hash; CTransaction tx1;
-        if ( GetTransaction(txin.prevout.hash,tx1,hash,false) )
+        // shares the spent output lookups with CheckTxAuthority when the notarisation is indexed
+        if ( GetSpentPubkey(txin,pubkey) )
         {
+            if ( pubkey.size() != 33 )
+                continue;
             for (int8_t i = 0; i < numNN; i++) 
             {
-                script = (uint8_t *)&tx1.vout[txin.prevout.n].scriptPubKey[0];
-                scriptlen = (int32_t)tx1.vout[txin.prevout.n].scriptPubKey.size();
-                if ( scriptlen == 35 && script[0] == 33 && script[34] == OP_CHECKSIG && memcmp(script+1,notarypubkeys[i],33) == 0 )
+                if ( memcmp(&pubkey[0],notarypubkeys[i],33) == 0 )
                     NotarisationNotaries.push_back(i);
             }
         } else return false;
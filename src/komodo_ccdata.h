@@ -19,23 +19,51 @@
 struct komodo_ccdata *CC_data;
 int32_t CC_firstheight;
 
-uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves, std::vector<uint256> &vMerkleTree);
+uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> &leaves, std::vector<uint256> &vMerkleTree);
 
-uint256 komodo_calcMoM(int32_t height,int32_t MoMdepth)
+// merkle trees over the block merkle roots of recent MoMs, so that the MoM a notarisation commits to and the proofs
+// made against it later share one tree. The hash of the top block pins the whole range, so entries survive reorgs elsewhere
+#define KOMODO_MOMTREES 8
+struct komodo_MoMtree { int32_t height,MoMdepth; uint256 blockhash; std::shared_ptr<const std::vector<uint256> > tree; };
+static struct komodo_MoMtree MoMtrees[KOMODO_MOMTREES]; static int32_t MoMtreei;
+static CCriticalSection cs_MoMtrees;
+
+std::shared_ptr<const std::vector<uint256> > komodo_MoMtree(int32_t height,int32_t MoMdepth)
 {
-    static uint256 zero; CBlockIndex *pindex; int32_t i; std::vector<uint256> tree, leaves;
-    bool fMutated;
+    CBlockIndex *pindex,*top; int32_t i; std::vector<uint256> leaves; std::shared_ptr<std::vector<uint256> > tree; bool fMutated;
     MoMdepth &= 0xffff;  // In case it includes the ccid
-    if ( MoMdepth >= height )
-        return(zero);
-    for (i=0; i<MoMdepth; i++)
+    if ( MoMdepth >= height || (top= komodo_chainactive(height)) == 0 )
+        return(nullptr);
     {
-        if ( (pindex= komodo_chainactive(height - i)) != 0 )
-            leaves.push_back(pindex->hashMerkleRoot);
-        else
-            return(zero);
+        LOCK(cs_MoMtrees);
+        for (i=0; i<KOMODO_MOMTREES; i++)
+            if ( MoMtrees[i].tree != nullptr && MoMtrees[i].height == height && MoMtrees[i].MoMdepth == MoMdepth && MoMtrees[i].blockhash == top->GetBlockHash() )
+                return(MoMtrees[i].tree);
+    }
+    leaves.reserve(MoMdepth);
+    for (i=0,pindex=top; i<MoMdepth; i++,pindex=pindex->pprev)
+    {
+        if ( pindex == 0 )
+            return(nullptr);
+        leaves.push_back(pindex->hashMerkleRoot);
     }
-    return BuildMerkleTree(&fMutated, leaves, tree);
+    tree = std::make_shared<std::vector<uint256> >();
+    BuildMerkleTree(&fMutated, leaves, *tree);
+    LOCK(cs_MoMtrees);
+    MoMtrees[MoMtreei].height = height;
+    MoMtrees[MoMtreei].MoMdepth = MoMdepth;
+    MoMtrees[MoMtreei].blockhash = top->GetBlockHash();
+    MoMtrees[MoMtreei].tree = tree;
+    MoMtreei = (MoMtreei + 1) % KOMODO_MOMTREES;
+    return(tree);
+}
+
+uint256 komodo_calcMoM(int32_t height,int32_t MoMdepth)
+{
+    static uint256 zero; std::shared_ptr<const std::vector<uint256> > tree;
+    if ( (tree= komodo_MoMtree(height,MoMdepth)) == nullptr || tree->empty() )
+        return(zero);
+    return(tree->back());
 }
 
 struct komodo_ccdata_entry *komodo_allMoMs(int32_t *nump,uint256 *MoMoMp,int32_t kmdstarti,int32_t kmdendi)
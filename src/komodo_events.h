@@ -17,6 +17,20 @@
 #define H_KOMODOEVENTS_H
 #include "komodo_defs.h"
 
+// events are only read back by komodo_event_rewind, which can never go below the notarized height
+void komodo_event_prune(struct komodo_state *sp)
+{
+    int32_t i,n = 0;
+    while ( n < sp->Komodo_numevents && sp->Komodo_events[n]->height < sp->NOTARIZED_HEIGHT )
+        n++;
+    if ( n == 0 )
+        return;
+    for (i=0; i<n; i++)
+        free(sp->Komodo_events[i]);
+    sp->Komodo_numevents -= n;
+    memmove(sp->Komodo_events,&sp->Komodo_events[n],sp->Komodo_numevents * sizeof(*sp->Komodo_events));
+}
+
 struct komodo_event *komodo_eventadd(struct komodo_state *sp,int32_t height,char *symbol,uint8_t type,uint8_t *data,uint16_t datalen)
 {
     struct komodo_event *ep=0; uint16_t len = (uint16_t)(sizeof(*ep) + datalen);
@@ -30,7 +44,16 @@ struct komodo_event *komodo_eventadd(struct komodo_state *sp,int32_t height,char
         strcpy(ep->symbol,symbol);
         if ( datalen != 0 )
             memcpy(ep->space,data,datalen);
-        sp->Komodo_events = (struct komodo_event **)realloc(sp->Komodo_events,(1 + sp->Komodo_numevents) * sizeof(*sp->Komodo_events));
+        if ( sp->Komodo_numevents >= sp->Komodo_maxevents )
+        {
+            // drop what can no longer be rewound before growing, so the log stays bounded by the unnotarized tail
+            komodo_event_prune(sp);
+            if ( sp->Komodo_numevents >= sp->Komodo_maxevents/2 )
+            {
+                sp->Komodo_maxevents = (sp->Komodo_maxevents == 0) ? 1024 : sp->Komodo_maxevents * 2;
+                sp->Komodo_events = (struct komodo_event **)realloc(sp->Komodo_events,sp->Komodo_maxevents * sizeof(*sp->Komodo_events));
+            }
+        }
         sp->Komodo_events[sp->Komodo_numevents++] = ep;
         portable_mutex_unlock(&komodo_mutex);
     }
@@ -147,6 +170,7 @@ void komodo_event_rewind(struct komodo_state *sp,char *symbol,int32_t height)
                 //printf("[%s] undo %s event.%c ht.%d for rewind.%d\n",ASSETCHAINS_SYMBOL,symbol,ep->type,ep->height,height);
                 komodo_event_undo(sp,ep);
                 sp->Komodo_numevents--;
+                free(ep);
             }
         }
     }
@@ -2756,6 +2756,12 @@ pthread_mutex_t pricemutex;
 // [2] 24hr ave
 // [3] to [7] reserved
 
+// records already read from the PRICES files, so that evaluating every bet at a height doesnt fseek/fread each symbol again
+// all the records of a height are written by komodo_pricesupdate() for that height, which drops it and everything above
+#define PRICES_RECORDCACHE_SIZE 100000
+struct komodo_pricerecord { int64_t data[PRICES_MAXDATAPOINTS]; };
+std::map<std::pair<int32_t,int32_t>,struct komodo_pricerecord> PRICES_recordcache; // (height,ind), protected by pricemutex
+
 void komodo_pricesupdate(int32_t height,CBlock *pblock)
 {
     static int numprices; static uint32_t *ptr32; static int64_t *ptr64,*tmpbuf;
@@ -2778,6 +2784,7 @@ void komodo_pricesupdate(int32_t height,CBlock *pblock)
         if ( PRICES[0].fp != 0 )
         {
             pthread_mutex_lock(&pricemutex);
+            PRICES_recordcache.erase(PRICES_recordcache.lower_bound(std::make_pair(height,0)),PRICES_recordcache.end());
             fseek(PRICES[0].fp,height * numprices * sizeof(uint32_t),SEEK_SET);
             if ( fwrite(rawprices,sizeof(uint32_t),numprices,PRICES[0].fp) != numprices )
                 fprintf(stderr,"error writing rawprices for ht.%d\n",height);
@@ -2832,13 +2839,24 @@ void komodo_pricesupdate(int32_t height,CBlock *pblock)
 
 int32_t komodo_priceget(int64_t *buf64,int32_t ind,int32_t height,int32_t numblocks)
 {
-    FILE *fp; int32_t retval = PRICES_MAXDATAPOINTS;
+    FILE *fp; int32_t retval = PRICES_MAXDATAPOINTS; std::map<std::pair<int32_t,int32_t>,struct komodo_pricerecord>::iterator it;
     pthread_mutex_lock(&pricemutex);
     if ( ind < KOMODO_MAXPRICES && (fp= PRICES[ind].fp) != 0 )
     {
-        fseek(fp,height * PRICES_MAXDATAPOINTS * sizeof(int64_t),SEEK_SET);
-        if ( fread(buf64,sizeof(int64_t),numblocks*PRICES_MAXDATAPOINTS,fp) != numblocks*PRICES_MAXDATAPOINTS )
-            retval = -1;
+        if ( numblocks == 1 && (it= PRICES_recordcache.find(std::make_pair(height,ind))) != PRICES_recordcache.end() )
+            memcpy(buf64,it->second.data,sizeof(it->second.data));
+        else
+        {
+            fseek(fp,height * PRICES_MAXDATAPOINTS * sizeof(int64_t),SEEK_SET);
+            if ( fread(buf64,sizeof(int64_t),numblocks*PRICES_MAXDATAPOINTS,fp) != numblocks*PRICES_MAXDATAPOINTS )
+                retval = -1;
+            else if ( numblocks == 1 )
+            {
+                if ( PRICES_recordcache.size() >= PRICES_RECORDCACHE_SIZE )
+                    PRICES_recordcache.erase(PRICES_recordcache.begin()); // lowest height
+                memcpy(PRICES_recordcache[std::make_pair(height,ind)].data,buf64,sizeof(struct komodo_pricerecord));
+            }
+        }
     }
     pthread_mutex_unlock(&pricemutex);
     return(retval);
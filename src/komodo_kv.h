@@ -42,6 +42,12 @@ int32_t komodo_kvduration(uint32_t flags)
     return(komodo_kvnumdays(flags) * KOMODO_KVDURATION);
 }
 
+// last height an entry set at height is live, in 64 bits since height comes from the opret
+int64_t komodo_kvexpiry(int32_t height,uint32_t flags)
+{
+    return((int64_t)height + komodo_kvduration(flags));
+}
+
 uint64_t komodo_kvfee(uint32_t flags,int32_t opretlen,int32_t keylen)
 {
     int32_t numdays,k; uint64_t fee;
@@ -53,9 +59,59 @@ uint64_t komodo_kvfee(uint32_t flags,int32_t opretlen,int32_t keylen)
     return(fee);
 }
 
+// expiry height -> keys that were set to expire then, keys updated since are skipped when their bucket comes up
+std::map<int64_t,std::vector<std::string> > KOMODO_KVexpiry;
+
+void komodo_kvfree(struct komodo_kv *ptr)
+{
+    HASH_DELETE(hh,KOMODO_KV,ptr);
+    if ( ptr->value != 0 )
+        free(ptr->value);
+    if ( ptr->key != 0 )
+        free(ptr->key);
+    free(ptr);
+}
+
+// drops the entries that expired before height, called as blocks are connected
+void komodo_kvpurge(int32_t height)
+{
+    struct komodo_kv *ptr;
+    portable_mutex_lock(&KOMODO_KV_mutex);
+    while ( KOMODO_KVexpiry.empty() == 0 && KOMODO_KVexpiry.begin()->first < height )
+    {
+        const std::vector<std::string> &keys = KOMODO_KVexpiry.begin()->second;
+        for (int32_t i=0; i<keys.size(); i++)
+        {
+            HASH_FIND(hh,KOMODO_KV,keys[i].data(),(int32_t)keys[i].size(),ptr);
+            if ( ptr != 0 && height > komodo_kvexpiry(ptr->height,ptr->flags) )
+                komodo_kvfree(ptr);
+        }
+        KOMODO_KVexpiry.erase(KOMODO_KVexpiry.begin());
+    }
+    portable_mutex_unlock(&KOMODO_KV_mutex);
+}
+
+// keys starting with prefix that have not expired at current_height, plus the ones only set by mempool txs
+int32_t komodo_kvlist(std::vector<std::string> &keys,int32_t current_height,uint8_t *prefix,int32_t prefixlen)
+{
+    struct komodo_kv *ptr,*tmp;
+    portable_mutex_lock(&KOMODO_KV_mutex);
+    HASH_ITER(hh,KOMODO_KV,ptr,tmp)
+    {
+        if ( ptr->keylen >= prefixlen && memcmp(ptr->key,prefix,prefixlen) == 0 && current_height <= komodo_kvexpiry(ptr->height,ptr->flags) )
+            keys.push_back(std::string((char *)ptr->key,ptr->keylen));
+    }
+    portable_mutex_unlock(&KOMODO_KV_mutex);
+    if ( KOMODO_NSPV_SUPERLITE == 0 )
+        mempool.getKVKeys(keys,std::string((char *)prefix,prefixlen));
+    std::sort(keys.begin(),keys.end());
+    keys.erase(std::unique(keys.begin(),keys.end()),keys.end());
+    return((int32_t)keys.size());
+}
+
 int32_t komodo_kvsearch(uint256 *pubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen)
 {
-    struct komodo_kv *ptr; int32_t duration,retval = -1;
+    struct komodo_kv *ptr; int32_t retval = -1;
     *heightp = -1;
     *flagsp = 0;
     memset(pubkeyp,0,sizeof(*pubkeyp));
@@ -63,17 +119,9 @@ int32_t komodo_kvsearch(uint256 *pubkeyp,int32_t current_height,uint32_t *flagsp
     HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
     if ( ptr != 0 )
     {
-        duration = komodo_kvduration(ptr->flags);
-        //fprintf(stderr,"duration.%d flags.%d current.%d ht.%d keylen.%d valuesize.%d\n",duration,ptr->flags,current_height,ptr->height,ptr->keylen,ptr->valuesize);
-        if ( current_height > (ptr->height + duration) )
-        {
-            HASH_DELETE(hh,KOMODO_KV,ptr);
-            if ( ptr->value != 0 )
-                free(ptr->value);
-            if ( ptr->key != 0 )
-                free(ptr->key);
-            free(ptr);
-        }
+        //fprintf(stderr,"flags.%d current.%d ht.%d keylen.%d valuesize.%d\n",ptr->flags,current_height,ptr->height,ptr->keylen,ptr->valuesize);
+        if ( current_height > komodo_kvexpiry(ptr->height,ptr->flags) )
+            komodo_kvfree(ptr);
         else
         {
             *heightp = ptr->height;
@@ -90,112 +138,202 @@ int32_t komodo_kvsearch(uint256 *pubkeyp,int32_t current_height,uint32_t *flagsp
         }
     } //else fprintf(stderr,"couldnt find (%s)\n",(char *)key);
     portable_mutex_unlock(&KOMODO_KV_mutex);
-    if ( retval < 0 )
-    {
-        // search rawmempool
-    }
+    // only blocks are searched here, komodo_kvupdate depends on it, see komodo_kvsearch_mempool for the rawmempool
     return(retval);
 }
 
-void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
+struct komodo_kvopret
 {
-    static uint256 zeroes;
-    uint32_t flags; uint256 pubkey,refpubkey,sig; int32_t i,refvaluesize,hassig,coresize,haspubkey,height,kvheight; uint16_t keylen,valuesize,newflag = 0; uint8_t *key,*valueptr,keyvalue[IGUANA_MAXSCRIPTSIZE*8]; struct komodo_kv *ptr; char *transferpubstr,*tstr; uint64_t fee;
-    if ( ASSETCHAINS_SYMBOL[0] == 0 ) // disable KV for KMD
-        return;
-    iguana_rwnum(0,&opretbuf[1],sizeof(keylen),&keylen);
-    iguana_rwnum(0,&opretbuf[3],sizeof(valuesize),&valuesize);
-    iguana_rwnum(0,&opretbuf[5],sizeof(height),&height);
-    iguana_rwnum(0,&opretbuf[9],sizeof(flags),&flags);
-    key = &opretbuf[13];
-    if ( keylen+13 > opretlen )
+    uint8_t *key,*valueptr;
+    uint16_t keylen,valuesize;
+    int32_t height;
+    uint32_t flags;
+    uint256 pubkey,sig;
+};
+
+// splits a KV opreturn into its fields, which point into opretbuf, returns < 0 if it isnt a valid update
+int32_t komodo_kvdecode(struct komodo_kvopret *kv,uint8_t *opretbuf,int32_t opretlen,uint64_t value)
+{
+    int32_t i,coresize; uint64_t fee;
+    memset(kv,0,sizeof(*kv));
+    iguana_rwnum(0,&opretbuf[1],sizeof(kv->keylen),&kv->keylen);
+    iguana_rwnum(0,&opretbuf[3],sizeof(kv->valuesize),&kv->valuesize);
+    iguana_rwnum(0,&opretbuf[5],sizeof(kv->height),&kv->height);
+    iguana_rwnum(0,&opretbuf[9],sizeof(kv->flags),&kv->flags);
+    kv->key = &opretbuf[13];
+    if ( kv->keylen+13 > opretlen )
     {
         static uint32_t counter;
         if ( ++counter < 1 )
-            fprintf(stderr,"komodo_kvupdate: keylen.%d + 13 > opretlen.%d, this can be ignored\n",keylen,opretlen);
-        return;
+            fprintf(stderr,"komodo_kvupdate: keylen.%d + 13 > opretlen.%d, this can be ignored\n",kv->keylen,opretlen);
+        return(-1);
+    }
+    kv->valueptr = &kv->key[kv->keylen];
+    fee = komodo_kvfee(kv->flags,opretlen,kv->keylen);
+    //fprintf(stderr,"fee %.8f vs %.8f flags.%d keylen.%d valuesize.%d height.%d (%02x %02x %02x) (%02x %02x %02x)\n",(double)fee/COIN,(double)value/COIN,kv->flags,kv->keylen,kv->valuesize,kv->height,kv->key[0],kv->key[1],kv->key[2],kv->valueptr[0],kv->valueptr[1],kv->valueptr[2]);
+    if ( value < fee )
+        return(-2);
+    coresize = (int32_t)(sizeof(kv->flags)+sizeof(kv->height)+sizeof(kv->keylen)+sizeof(kv->valuesize)+kv->keylen+kv->valuesize+1);
+    if ( opretlen != coresize && opretlen != coresize+sizeof(uint256) && opretlen != coresize+2*sizeof(uint256) )
+        return(-3);
+    if ( opretlen >= coresize+sizeof(uint256) )
+    {
+        for (i=0; i<32; i++)
+            ((uint8_t *)&kv->pubkey)[i] = opretbuf[coresize+i];
+    }
+    if ( opretlen == coresize+sizeof(uint256)*2 )
+    {
+        for (i=0; i<32; i++)
+            ((uint8_t *)&kv->sig)[i] = opretbuf[coresize+sizeof(uint256)+i];
+    }
+    return(0);
+}
+
+// a "transfer:<hex pubkey>" value hands an existing key to a new owner
+void komodo_kvtransfer(uint256 *pubkeyp,uint8_t *valueptr,uint8_t *key)
+{
+    char *transferpubstr,*tstr; int32_t i;
+    tstr = (char *)"transfer:";
+    transferpubstr = (char *)&valueptr[strlen(tstr)];
+    if ( strncmp(tstr,(char *)valueptr,strlen(tstr)) == 0 && is_hexstr(transferpubstr,0) == 64 )
+    {
+        printf("transfer.(%s) to [%s]? ishex.%d\n",key,transferpubstr,is_hexstr(transferpubstr,0));
+        for (i=0; i<32; i++)
+            ((uint8_t *)pubkeyp)[31-i] = _decode_hex(&transferpubstr[i*2]);
     }
-    valueptr = &key[keylen];
-    fee = komodo_kvfee(flags,opretlen,keylen);
-    //fprintf(stderr,"fee %.8f vs %.8f flags.%d keylen.%d valuesize.%d height.%d (%02x %02x %02x) (%02x %02x %02x)\n",(double)fee/COIN,(double)value/COIN,flags,keylen,valuesize,height,key[0],key[1],key[2],valueptr[0],valueptr[1],valueptr[2]);
-    if ( value >= fee )
+}
+
+// the KV opreturn in a tx output, as komodo_voutupdate extracts it from a block
+int32_t komodo_kvscript(std::vector<uint8_t> &opret,const CScript &scriptPubKey)
+{
+    CScript::const_iterator pc = scriptPubKey.begin(); opcodetype opcode;
+    opret.clear();
+    if ( !scriptPubKey.GetOp(pc,opcode) || opcode != OP_RETURN || !scriptPubKey.GetOp(pc,opcode,opret) )
+        return(0);
+    if ( opret.size() < 13 || opret[0] != 'K' || opret.size() == 40 )
+        return(0);
+    return((int32_t)opret.size());
+}
+
+// komodo_kvsearch with the KV updates waiting in the mempool applied on top, in the order they arrived and
+// with the checks komodo_kvupdate makes once they are mined, so an update shows up before its block does
+int32_t komodo_kvsearch_mempool(uint256 *pubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen)
+{
+    static uint256 zeroes;
+    std::vector<CTransaction> txs; std::vector<uint8_t> opret; struct komodo_kvopret kv; uint8_t keyvalue[IGUANA_MAXSCRIPTSIZE*8]; uint256 pubkey; int32_t i,j,retval;
+    retval = komodo_kvsearch(pubkeyp,current_height,flagsp,heightp,value,key,keylen);
+    if ( ASSETCHAINS_SYMBOL[0] == 0 || KOMODO_NSPV_SUPERLITE != 0 )
+        return(retval);
+    mempool.getKVTransactions(txs,std::string((char *)key,keylen));
+    for (i=0; i<txs.size(); i++)
     {
-        coresize = (int32_t)(sizeof(flags)+sizeof(height)+sizeof(keylen)+sizeof(valuesize)+keylen+valuesize+1);
-        if ( opretlen == coresize || opretlen == coresize+sizeof(uint256) || opretlen == coresize+2*sizeof(uint256) )
+        for (j=0; j<txs[i].vout.size(); j++)
         {
-            memset(&pubkey,0,sizeof(pubkey));
-            memset(&sig,0,sizeof(sig));
-            if ( (haspubkey= (opretlen >= coresize+sizeof(uint256))) != 0 )
+            if ( komodo_kvscript(opret,txs[i].vout[j].scriptPubKey) == 0 || komodo_kvdecode(&kv,&opret[0],(int32_t)opret.size(),txs[i].vout[j].nValue) < 0 )
+                continue;
+            if ( kv.keylen != keylen || memcmp(kv.key,key,keylen) != 0 )
+                continue;
+            // komodo_kvupdate looks the key up at the height of the update
+            if ( retval >= 0 && kv.height > komodo_kvexpiry(*heightp,*flagsp) )
             {
-                for (i=0; i<32; i++)
-                    ((uint8_t *)&pubkey)[i] = opretbuf[coresize+i];
+                retval = -1;
+                *flagsp = 0;
+                memset(pubkeyp,0,sizeof(*pubkeyp));
             }
-            if ( (hassig= (opretlen == coresize+sizeof(uint256)*2)) != 0 )
+            if ( retval >= 0 && memcmp(&zeroes,pubkeyp,sizeof(*pubkeyp)) != 0 )
             {
-                for (i=0; i<32; i++)
-                    ((uint8_t *)&sig)[i] = opretbuf[coresize+sizeof(uint256)+i];
+                memcpy(keyvalue,key,keylen);
+                memcpy(&keyvalue[keylen],value,retval);
+                if ( komodo_kvsigverify(keyvalue,keylen+retval,*pubkeyp,kv.sig) < 0 )
+                    continue;
             }
-            memcpy(keyvalue,key,keylen);
-            if ( (refvaluesize= komodo_kvsearch((uint256 *)&refpubkey,height,&flags,&kvheight,&keyvalue[keylen],key,keylen)) >= 0 )
+            pubkey = kv.pubkey;
+            if ( retval >= 0 )
+                komodo_kvtransfer(&pubkey,kv.valueptr,kv.key);
+            if ( retval < 0 || (*flagsp & KOMODO_KVPROTECTED) == 0 )
             {
-                if ( memcmp(&zeroes,&refpubkey,sizeof(refpubkey)) != 0 )
-                {
-                    if ( komodo_kvsigverify(keyvalue,keylen+refvaluesize,refpubkey,sig) < 0 )
-                    {
-                        //fprintf(stderr,"komodo_kvsigverify error [%d]\n",coresize-13);
-                        return;
-                    }
-                }
+                if ( (retval= kv.valuesize) > 0 )
+                    memcpy(value,kv.valueptr,retval);
             }
-            portable_mutex_lock(&KOMODO_KV_mutex);
-            HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
-            if ( ptr != 0 )
-            {
-                //fprintf(stderr,"(%s) already there\n",(char *)key);
-                //if ( (ptr->flags & KOMODO_KVPROTECTED) != 0 )
-                {
-                    tstr = (char *)"transfer:";
-                    transferpubstr = (char *)&valueptr[strlen(tstr)];
-                    if ( strncmp(tstr,(char *)valueptr,strlen(tstr)) == 0 && is_hexstr(transferpubstr,0) == 64 )
-                    {
-                        printf("transfer.(%s) to [%s]? ishex.%d\n",key,transferpubstr,is_hexstr(transferpubstr,0));
-                        for (i=0; i<32; i++)
-                            ((uint8_t *)&pubkey)[31-i] = _decode_hex(&transferpubstr[i*2]);
-                    }
-                }
-            }
-            else if ( ptr == 0 )
+            // the flags of an entry are the ones it was created with, 0 for a new key
+            *pubkeyp = pubkey;
+            *heightp = kv.height;
+        }
+    }
+    if ( retval >= 0 && current_height > komodo_kvexpiry(*heightp,*flagsp) )
+        retval = -1;
+    return(retval);
+}
+
+void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
+{
+    static uint256 zeroes;
+    uint32_t flags; uint256 pubkey,refpubkey,sig; int32_t retval,refvaluesize,height,kvheight; uint16_t keylen,valuesize,newflag = 0; uint8_t *key,*valueptr,keyvalue[IGUANA_MAXSCRIPTSIZE*8]; struct komodo_kv *ptr; struct komodo_kvopret kv;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 ) // disable KV for KMD
+        return;
+    if ( (retval= komodo_kvdecode(&kv,opretbuf,opretlen,value)) < 0 )
+    {
+        if ( retval == -2 )
+            fprintf(stderr,"not enough fee\n");
+        else if ( retval == -3 )
+            fprintf(stderr,"KV update size mismatch opretlen.%d keylen.%d valuesize.%d\n",opretlen,kv.keylen,kv.valuesize);
+        return;
+    }
+    key = kv.key, keylen = kv.keylen;
+    valueptr = kv.valueptr, valuesize = kv.valuesize;
+    height = kv.height, flags = kv.flags;
+    pubkey = kv.pubkey, sig = kv.sig;
+    memcpy(keyvalue,key,keylen);
+    if ( (refvaluesize= komodo_kvsearch((uint256 *)&refpubkey,height,&flags,&kvheight,&keyvalue[keylen],key,keylen)) >= 0 )
+    {
+        if ( memcmp(&zeroes,&refpubkey,sizeof(refpubkey)) != 0 )
+        {
+            if ( komodo_kvsigverify(keyvalue,keylen+refvaluesize,refpubkey,sig) < 0 )
             {
-                ptr = (struct komodo_kv *)calloc(1,sizeof(*ptr));
-                ptr->key = (uint8_t *)calloc(1,keylen);
-                ptr->keylen = keylen;
-                memcpy(ptr->key,key,keylen);
-                newflag = 1;
-                HASH_ADD_KEYPTR(hh,KOMODO_KV,ptr->key,ptr->keylen,ptr);
-                //fprintf(stderr,"KV add.(%s) (%s)\n",ptr->key,valueptr);
+                //fprintf(stderr,"komodo_kvsigverify error [%d]\n",coresize-13);
+                return;
             }
-            if ( newflag != 0 || (ptr->flags & KOMODO_KVPROTECTED) == 0 )
-            {
-                if ( ptr->value != 0 )
-                    free(ptr->value), ptr->value = 0;
-                if ( (ptr->valuesize= valuesize) != 0 )
-                {
-                    ptr->value = (uint8_t *)calloc(1,valuesize);
-                    memcpy(ptr->value,valueptr,valuesize);
-                }
-            } else fprintf(stderr,"newflag.%d zero or protected %d\n",newflag,(ptr->flags & KOMODO_KVPROTECTED));
-            /*for (i=0; i<32; i++)
-                printf("%02x",((uint8_t *)&ptr->pubkey)[i]);
-            printf(" <- ");
-            for (i=0; i<32; i++)
-                printf("%02x",((uint8_t *)&pubkey)[i]);
-            printf(" new pubkey\n");*/
-            memcpy(&ptr->pubkey,&pubkey,sizeof(ptr->pubkey));
-            ptr->height = height;
-            ptr->flags = flags; // jl777 used to or in KVPROTECTED
-            portable_mutex_unlock(&KOMODO_KV_mutex);
-        } else fprintf(stderr,"KV update size mismatch %d vs %d\n",opretlen,coresize);
-    } else fprintf(stderr,"not enough fee\n");
+        }
+    }
+    portable_mutex_lock(&KOMODO_KV_mutex);
+    HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
+    if ( ptr != 0 )
+    {
+        //fprintf(stderr,"(%s) already there\n",(char *)key);
+        //if ( (ptr->flags & KOMODO_KVPROTECTED) != 0 )
+        komodo_kvtransfer(&pubkey,valueptr,key);
+    }
+    else if ( ptr == 0 )
+    {
+        ptr = (struct komodo_kv *)calloc(1,sizeof(*ptr));
+        ptr->key = (uint8_t *)calloc(1,keylen);
+        ptr->keylen = keylen;
+        memcpy(ptr->key,key,keylen);
+        newflag = 1;
+        HASH_ADD_KEYPTR(hh,KOMODO_KV,ptr->key,ptr->keylen,ptr);
+        //fprintf(stderr,"KV add.(%s) (%s)\n",ptr->key,valueptr);
+    }
+    if ( newflag != 0 || (ptr->flags & KOMODO_KVPROTECTED) == 0 )
+    {
+        if ( ptr->value != 0 )
+            free(ptr->value), ptr->value = 0;
+        if ( (ptr->valuesize= valuesize) != 0 )
+        {
+            ptr->value = (uint8_t *)calloc(1,valuesize);
+            memcpy(ptr->value,valueptr,valuesize);
+        }
+    } else fprintf(stderr,"newflag.%d zero or protected %d\n",newflag,(ptr->flags & KOMODO_KVPROTECTED));
+    /*for (i=0; i<32; i++)
+        printf("%02x",((uint8_t *)&ptr->pubkey)[i]);
+    printf(" <- ");
+    for (i=0; i<32; i++)
+        printf("%02x",((uint8_t *)&pubkey)[i]);
+    printf(" new pubkey\n");*/
+    memcpy(&ptr->pubkey,&pubkey,sizeof(ptr->pubkey));
+    ptr->height = height;
+    ptr->flags = flags; // jl777 used to or in KVPROTECTED
+    KOMODO_KVexpiry[komodo_kvexpiry(height,flags)].push_back(std::string((char *)ptr->key,ptr->keylen));
+    portable_mutex_unlock(&KOMODO_KV_mutex);
 }
 
 #endif
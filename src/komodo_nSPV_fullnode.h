@@ -28,6 +28,22 @@ static std::map<std::string,bool> nspv_remote_commands =  {{"channelsopen", true
 {"gatewayspartialsign", true},{"gatewayscompletesigning", true},{"gatewaysmarkdone", true},{"gatewayspendingdeposits", true},{"gatewayspendingwithdraws", true},
 {"gatewaysprocessed", true},{"gatewaysinfo", false},{"gatewayslist", false},{"faucetfund", true},{"faucetget", true}};
 
+// requests are served from several message handler threads, so the lookups into
+// chainActive, mapBlockIndex and pcoinsTip take cs_main just for themselves and
+// the index, mempool and block file reads around them run without it
+
+int32_t NSPV_tipheight()
+{
+    LOCK(cs_main);
+    return(chainActive.LastTip()->GetHeight());
+}
+
+int32_t NSPV_blockheight(uint256 hash)
+{
+    LOCK(cs_main);
+    return(komodo_blockheight(hash));
+}
+
 struct NSPV_ntzargs
 {
     uint256 txid,desttxid,blockhash;
@@ -41,7 +57,11 @@ int32_t NSPV_notarization_find(struct NSPV_ntzargs *args,int32_t height,int32_t
     memset(args,0,sizeof(*args));
     if ( dir > 0 )
         height += 10;
-    if ( (args->txidht= ScanNotarisationsDB(height,symbol,1440,nota)) == 0 )
+    {
+        LOCK(cs_main);
+        args->txidht = ScanNotarisationsDB(height,symbol,1440,nota);
+    }
+    if ( args->txidht == 0 )
         return(-1);
     args->txid = nota.first;
     if ( !GetTransaction(args->txid,tx,hashBlock,false) || tx.vout.size() < 2 )
@@ -77,6 +97,7 @@ int32_t NSPV_notarized_bracket(struct NSPV_ntzargs *prev,struct NSPV_ntzargs *ne
 int32_t NSPV_ntzextract(struct NSPV_ntz *ptr,uint256 ntztxid,int32_t txidht,uint256 desttxid,int32_t ntzheight)
 {
     CBlockIndex *pindex;
+    LOCK(cs_main);
     ptr->blockhash = *chainActive[ntzheight]->phashBlock;
     ptr->height = ntzheight;
     ptr->txidheight = txidht;
@@ -90,7 +111,7 @@ int32_t NSPV_ntzextract(struct NSPV_ntz *ptr,uint256 ntztxid,int32_t txidht,uint
 int32_t NSPV_getntzsresp(struct NSPV_ntzsresp *ptr,int32_t origreqheight)
 {
     struct NSPV_ntzargs prev,next; int32_t reqheight = origreqheight;
-    if ( reqheight < chainActive.LastTip()->GetHeight() )
+    if ( reqheight < NSPV_tipheight() )
         reqheight++;
     if ( NSPV_notarized_bracket(&prev,&next,reqheight) == 0 )
     {
@@ -112,6 +133,7 @@ int32_t NSPV_getntzsresp(struct NSPV_ntzsresp *ptr,int32_t origreqheight)
 int32_t NSPV_setequihdr(struct NSPV_equihdr *hdr,int32_t height)
 {
     CBlockIndex *pindex;
+    LOCK(cs_main);
     if ( (pindex= komodo_chainactive(height)) != 0 )
     {
         hdr->nVersion = pindex->nVersion;
@@ -132,25 +154,30 @@ int32_t NSPV_setequihdr(struct NSPV_equihdr *hdr,int32_t height)
 int32_t NSPV_getinfo(struct NSPV_inforesp *ptr,int32_t reqheight)
 {
     int32_t prevMoMheight,len = 0; CBlockIndex *pindex, *pindex2; struct NSPV_ntzsresp pair;
-    if ( (pindex= chainActive.LastTip()) != 0 )
     {
+        LOCK(cs_main);
+        if ( (pindex= chainActive.LastTip()) == 0 )
+            return(-1);
         ptr->height = pindex->GetHeight();
         ptr->blockhash = pindex->GetBlockHash();
-        memset(&pair,0,sizeof(pair));
-        if ( NSPV_getntzsresp(&pair,ptr->height-1) < 0 )
-            return(-1);
-        ptr->notarization = pair.prevntz;
+    }
+    memset(&pair,0,sizeof(pair));
+    if ( NSPV_getntzsresp(&pair,ptr->height-1) < 0 )
+        return(-1);
+    ptr->notarization = pair.prevntz;
+    {
+        LOCK(cs_main);
         if ( (pindex2= komodo_chainactive(ptr->notarization.txidheight)) != 0 )
             ptr->notarization.timestamp = pindex->nTime;
-        //fprintf(stderr, "timestamp.%i\n", ptr->notarization.timestamp );
-        if ( reqheight == 0 )
-            reqheight = ptr->height;
-        ptr->hdrheight = reqheight;
-        ptr->version = NSPV_PROTOCOL_VERSION;
-        if ( NSPV_setequihdr(&ptr->H,reqheight) < 0 )
-            return(-1);
-        return(sizeof(*ptr));
-    } else return(-1);
+    }
+    //fprintf(stderr, "timestamp.%i\n", ptr->notarization.timestamp );
+    if ( reqheight == 0 )
+        reqheight = ptr->height;
+    ptr->hdrheight = reqheight;
+    ptr->version = NSPV_PROTOCOL_VERSION;
+    if ( NSPV_setequihdr(&ptr->H,reqheight) < 0 )
+        return(-1);
+    return(sizeof(*ptr));
 }
 
 int32_t NSPV_getaddressutxos(struct NSPV_utxosresp *ptr,char *coinaddr,bool isCC,int32_t skipcount,uint32_t filter)
@@ -167,19 +194,24 @@ int32_t NSPV_getaddressutxos(struct NSPV_utxosresp *ptr,char *coinaddr,bool isCC
         skipcount = 0;
     if ( (ptr->numutxos= (int32_t)unspentOutputs.size()) >= 0 && ptr->numutxos < maxlen )
     {
-        tipheight = chainActive.LastTip()->GetHeight();
+        tipheight = NSPV_tipheight();
         ptr->nodeheight = tipheight;
         if ( skipcount >= ptr->numutxos )
             skipcount = ptr->numutxos-1;
         ptr->skipcount = skipcount;
         if ( ptr->numutxos-skipcount > 0 )
         {
+            std::vector<COutPoint> outpoints; std::vector<bool> spent;
             ptr->utxos = (struct NSPV_utxoresp *)calloc(ptr->numutxos-skipcount,sizeof(*ptr->utxos));
+            outpoints.reserve(unspentOutputs.size());
+            for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
+                outpoints.push_back(COutPoint(it->first.txhash,it->first.index));
+            myIsutxos_spentinmempool(spent,outpoints);
             for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
             {
                 // if gettxout is != null to handle mempool
                 {
-                    if ( n >= skipcount && myIsutxo_spentinmempool(ignoretxid,ignorevin,it->first.txhash,(int32_t)it->first.index) == 0  )
+                    if ( n >= skipcount && spent[it - unspentOutputs.begin()] == 0  )
                     {
                         ptr->utxos[ind].txid = it->first.txhash;
                         ptr->utxos[ind].vout = (int32_t)it->first.index;
@@ -187,6 +219,7 @@ int32_t NSPV_getaddressutxos(struct NSPV_utxosresp *ptr,char *coinaddr,bool isCC
                         ptr->utxos[ind].height = it->second.blockHeight;
                         if ( ASSETCHAINS_SYMBOL[0] == 0 && it->second.satoshis >= 10*COIN )
                         {
+                            LOCK(cs_main);
                             ptr->utxos[n].extradata = komodo_accrued_interest(&txheight,&locktime,ptr->utxos[ind].txid,ptr->utxos[ind].vout,ptr->utxos[ind].height,ptr->utxos[ind].satoshis,tipheight);
                             interest += ptr->utxos[ind].extradata;
                         }
@@ -333,7 +366,7 @@ int32_t NSPV_getccmoduleutxos(struct NSPV_utxosresp *ptr, char *coinaddr, int64_
     ptr->numutxos = 0;
     strncpy(ptr->coinaddr, coinaddr, sizeof(ptr->coinaddr) - 1);
     ptr->CCflag = 1;
-    tipheight = chainActive.LastTip()->GetHeight();  
+    tipheight = NSPV_tipheight();
     ptr->nodeheight = tipheight; // will be checked in libnspv
     //}
    
@@ -441,7 +474,7 @@ int32_t NSPV_getaddresstxids(struct NSPV_txidsresp *ptr,char *coinaddr,bool isCC
     int32_t maxlen,txheight,ind=0,n = 0,len = 0; CTransaction tx; uint256 hashBlock;
     std::vector<std::pair<CAddressIndexKey, CAmount> > txids;
     SetCCtxids(txids,coinaddr,isCC);
-    ptr->nodeheight = chainActive.LastTip()->GetHeight();
+    ptr->nodeheight = NSPV_tipheight();
     maxlen = MAX_BLOCK_SIZE(ptr->nodeheight) - 512;
     maxlen /= sizeof(*ptr->txids);
     strncpy(ptr->coinaddr,coinaddr,sizeof(ptr->coinaddr)-1);
@@ -482,7 +515,7 @@ int32_t NSPV_getaddresstxids(struct NSPV_txidsresp *ptr,char *coinaddr,bool isCC
 
 int32_t NSPV_mempoolfuncs(bits256 *satoshisp,int32_t *vindexp,std::vector<uint256> &txids,char *coinaddr,bool isCC,uint8_t funcid,uint256 txid,int32_t vout)
 {
-    int32_t num = 0,vini = 0,vouti = 0; uint8_t evalcode=0,func=0;  std::vector<uint8_t> vopret; char destaddr[64];
+    int32_t num = 0,vini = 0,vouti = 0; char destaddr[64];
     *vindexp = -1;
     memset(satoshisp,0,sizeof(*satoshisp));
     if ( funcid == NSPV_CC_TXIDS)
@@ -540,9 +573,8 @@ int32_t NSPV_mempoolfuncs(bits256 *satoshisp,int32_t *vindexp,std::vector<uint25
         return(0);
     if ( funcid == NSPV_MEMPOOL_CCEVALCODE )
     {
-        isCC = true;
-        evalcode = vout & 0xff;
-        func = (vout >> 8) & 0xff;
+        mempool.getCCIndex(txids,vout & 0xff,(vout >> 8) & 0xff);
+        return((int32_t)txids.size());
     }
     LOCK(mempool.cs);
     BOOST_FOREACH(const CTxMemPoolEntry &e,mempool.mapTx)
@@ -564,22 +596,6 @@ int32_t NSPV_mempoolfuncs(bits256 *satoshisp,int32_t *vindexp,std::vector<uint25
             }
             continue;
         }
-        else if ( funcid == NSPV_MEMPOOL_CCEVALCODE )
-        {
-            if ( tx.vout.size() > 1 )
-            {
-                CScript scriptPubKey = tx.vout[tx.vout.size()-1].scriptPubKey;
-                if ( GetOpReturnData(scriptPubKey,vopret) != 0 )
-                {
-                    if ( vopret[0] == evalcode && vopret[1] == func )
-                    {
-                        txids.push_back(hash);
-                        num++;
-                    }
-                }
-            }
-            continue;
-        }
         if ( funcid == NSPV_MEMPOOL_ISSPENT )
         {
             BOOST_FOREACH(const CTxIn &txin,tx.vin)
@@ -621,7 +637,7 @@ int32_t NSPV_mempoolfuncs(bits256 *satoshisp,int32_t *vindexp,std::vector<uint25
 int32_t NSPV_mempooltxids(struct NSPV_mempoolresp *ptr,char *coinaddr,uint8_t isCC,uint8_t funcid,uint256 txid,int32_t vout)
 {
     std::vector<uint256> txids; bits256 satoshis; uint256 tmp,tmpdest; int32_t i,len = 0;
-    ptr->nodeheight = chainActive.LastTip()->GetHeight();
+    ptr->nodeheight = NSPV_tipheight();
     strncpy(ptr->coinaddr,coinaddr,sizeof(ptr->coinaddr)-1);
     ptr->CCflag = isCC;
     ptr->txid = txid;
@@ -738,10 +754,14 @@ int32_t NSPV_sendrawtransaction(struct NSPV_broadcastresp *ptr,uint8_t *data,int
     ptr->retcode = 0;
     if ( NSPV_txextract(tx,data,n) == 0 )
     {
-        //LOCK(cs_main);
+        bool fAccepted;
         ptr->txid = tx.GetHash();
         //fprintf(stderr,"try to addmempool transaction %s\n",ptr->txid.GetHex().c_str());
-        if ( myAddtomempool(tx) != 0 )
+        {
+            LOCK(cs_main);
+            fAccepted = myAddtomempool(tx);
+        }
+        if ( fAccepted )
         {
             ptr->retcode = 1;
             //int32_t i;
@@ -765,11 +785,16 @@ int32_t NSPV_gettxproof(struct NSPV_txproof *ptr,int32_t vout,uint256 txid,int32
         ptr->vout = vout;
         ptr->hashblock = hashBlock;
         if ( height == 0 )
-            ptr->height = komodo_blockheight(hashBlock);
+            ptr->height = NSPV_blockheight(hashBlock);
         else
         {
             ptr->height = height;
-            if ( (pindex= komodo_chainactive(height)) != 0 && komodo_blockload(block,pindex) == 0 )
+            {
+                LOCK(cs_main);
+                pindex = komodo_chainactive(height);
+            }
+            // block index entries are never freed, so the read can run unlocked
+            if ( pindex != 0 && komodo_blockload(block,pindex) == 0 )
             {
                 BOOST_FOREACH(const CTransaction&tx, block.vtx)
                 {
@@ -798,6 +823,7 @@ int32_t NSPV_gettxproof(struct NSPV_txproof *ptr,int32_t vout,uint256 txid,int32
                 }
             }
         }
+        LOCK(cs_main);
         ptr->unspentvalue = CCgettxout(txid,vout,1,1);
     }
     return(sizeof(*ptr) - sizeof(ptr->tx) - sizeof(ptr->txproof) + ptr->txlen + ptr->txprooflen);
@@ -808,18 +834,18 @@ int32_t NSPV_getntzsproofresp(struct NSPV_ntzsproofresp *ptr,uint256 prevntztxid
     int32_t i; uint256 hashBlock,bhash0,bhash1,desttxid0,desttxid1; CTransaction tx;
     ptr->prevtxid = prevntztxid;
     ptr->prevntz = NSPV_getrawtx(tx,hashBlock,&ptr->prevtxlen,ptr->prevtxid);
-    ptr->prevtxidht = komodo_blockheight(hashBlock);
+    ptr->prevtxidht = NSPV_blockheight(hashBlock);
     if ( NSPV_notarizationextract(0,&ptr->common.prevht,&bhash0,&desttxid0,tx) < 0 )
         return(-2);
-    else if ( komodo_blockheight(bhash0) != ptr->common.prevht )
+    else if ( NSPV_blockheight(bhash0) != ptr->common.prevht )
         return(-3);
     
     ptr->nexttxid = nextntztxid;
     ptr->nextntz = NSPV_getrawtx(tx,hashBlock,&ptr->nexttxlen,ptr->nexttxid);
-    ptr->nexttxidht = komodo_blockheight(hashBlock);
+    ptr->nexttxidht = NSPV_blockheight(hashBlock);
     if ( NSPV_notarizationextract(0,&ptr->common.nextht,&bhash1,&desttxid1,tx) < 0 )
         return(-5);
-    else if ( komodo_blockheight(bhash1) != ptr->common.nextht )
+    else if ( NSPV_blockheight(bhash1) != ptr->common.nextht )
         return(-6);
 
     else if ( ptr->common.prevht > ptr->common.nextht || (ptr->common.nextht - ptr->common.prevht) > 1440 )
@@ -19,6 +19,9 @@
 
 #include "notaries_staked.h"
 
+#include <string>
+#include <unordered_map>
+
 #define KOMODO_MAINNET_START 178999
 #define KOMODO_NOTARIES_HEIGHT1 814000
 
@@ -87,50 +90,76 @@ int32_t getacseason(uint32_t timestamp)
     return(0);
 }
 
-int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestamp)
+// decoded pubkeys of an elected season and the notary id of each of them
+struct komodo_seasonnotaries
 {
-    int32_t i,htind,n; uint64_t mask = 0; struct knotary_entry *kp,*tmp;
-    static uint8_t kmd_pubkeys[NUM_KMD_SEASONS][64][33],didinit[NUM_KMD_SEASONS];
-    
-    if ( timestamp == 0 && ASSETCHAINS_SYMBOL[0] != 0 )
-        timestamp = komodo_heightstamp(height);
-    else if ( ASSETCHAINS_SYMBOL[0] == 0 )
-        timestamp = 0;
+    uint8_t pubkeys[NUM_KMD_NOTARIES][33];
+    std::unordered_map<std::string,int32_t> ids;
+};
 
-    // If this chain is not a staked chain, use the normal Komodo logic to determine notaries. This allows KMD to still sync and use its proper pubkeys for dPoW.
-    if ( is_STAKED(ASSETCHAINS_SYMBOL) == 0 )
+static struct komodo_seasonnotaries *komodo_seasontable()
+{
+    // the elected seasons are compiled in, so they are decoded once and never change
+    static struct komodo_seasonnotaries *table = []()
     {
-        int32_t kmd_season = 0;
-        if ( ASSETCHAINS_SYMBOL[0] == 0 )
-        {
-            // This is KMD, use block heights to determine the KMD notary season.. 
-            if ( height >= KOMODO_NOTARIES_HARDCODED )
-                kmd_season = getkmdseason(height);
-        }
-        else 
+        struct komodo_seasonnotaries *seasons = new komodo_seasonnotaries[NUM_KMD_SEASONS];
+        for (int32_t s=0; s<NUM_KMD_SEASONS; s++)
         {
-            // This is a non LABS assetchain, use timestamp to detemine notary pubkeys. 
-            kmd_season = getacseason(timestamp);
-        }
-        if ( kmd_season != 0 )
-        {
-            if ( didinit[kmd_season-1] == 0 )
+            for (int32_t i=0; i<NUM_KMD_NOTARIES; i++)
             {
-                for (i=0; i<NUM_KMD_NOTARIES; i++) 
-                    decode_hex(kmd_pubkeys[kmd_season-1][i],33,(char *)notaries_elected[kmd_season-1][i][1]);
+                decode_hex(seasons[s].pubkeys[i],33,(char *)notaries_elected[s][i][1]);
+                seasons[s].ids[std::string((char *)seasons[s].pubkeys[i],33)] = i;
                 if ( ASSETCHAINS_PRIVATE != 0 )
                 {
                     // this is PIRATE, we need to populate the address array for the notary exemptions. 
-                    for (i = 0; i<NUM_KMD_NOTARIES; i++)
-                        pubkey2addr((char *)NOTARY_ADDRESSES[kmd_season-1][i],(uint8_t *)kmd_pubkeys[kmd_season-1][i]);
+                    pubkey2addr((char *)NOTARY_ADDRESSES[s][i],(uint8_t *)seasons[s].pubkeys[i]);
                 }
-                didinit[kmd_season-1] = 1;
             }
-            memcpy(pubkeys,kmd_pubkeys[kmd_season-1],NUM_KMD_NOTARIES * 33);
-            return(NUM_KMD_NOTARIES);
         }
+        return(seasons);
+    }();
+    return(table);
+}
+
+// elected season in effect for height (KMD) or timestamp (assetchains), 0 when the notaries come from elsewhere
+int32_t komodo_notaryseason(int32_t height,uint32_t *timestampp)
+{
+    if ( *timestampp == 0 && ASSETCHAINS_SYMBOL[0] != 0 )
+        *timestampp = komodo_heightstamp(height);
+    else if ( ASSETCHAINS_SYMBOL[0] == 0 )
+        *timestampp = 0;
+
+    // If this chain is not a staked chain, use the normal Komodo logic to determine notaries. This allows KMD to still sync and use its proper pubkeys for dPoW.
+    if ( is_STAKED(ASSETCHAINS_SYMBOL) != 0 )
+        return(0);
+    if ( ASSETCHAINS_SYMBOL[0] == 0 )
+    {
+        // This is KMD, use block heights to determine the KMD notary season.. 
+        if ( height >= KOMODO_NOTARIES_HARDCODED )
+            return(getkmdseason(height));
+        return(0);
+    }
+    // This is a non LABS assetchain, use timestamp to detemine notary pubkeys. 
+    return(getacseason(*timestampp));
+}
+
+int32_t komodo_seasonnotaryid(int32_t kmd_season,const uint8_t *pubkey33)
+{
+    struct komodo_seasonnotaries *season = &komodo_seasontable()[kmd_season-1];
+    std::unordered_map<std::string,int32_t>::const_iterator it = season->ids.find(std::string((const char *)pubkey33,33));
+    return(it == season->ids.end() ? -1 : it->second);
+}
+
+int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestamp)
+{
+    int32_t htind,n,kmd_season; uint64_t mask = 0; struct knotary_entry *kp,*tmp;
+
+    if ( (kmd_season= komodo_notaryseason(height,&timestamp)) != 0 )
+    {
+        memcpy(pubkeys,komodo_seasontable()[kmd_season-1].pubkeys,NUM_KMD_NOTARIES * 33);
+        return(NUM_KMD_NOTARIES);
     }
-    else if ( timestamp != 0 )
+    else if ( is_STAKED(ASSETCHAINS_SYMBOL) != 0 && timestamp != 0 )
     { 
         // here we can activate our pubkeys for LABS chains everythig is in notaries_staked.cpp
         int32_t staked_era; int8_t numSN;
@@ -170,7 +199,12 @@ int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestam
 
 int32_t komodo_electednotary(int32_t *numnotariesp,uint8_t *pubkey33,int32_t height,uint32_t timestamp)
 {
-    int32_t i,n; uint8_t pubkeys[64][33];
+    int32_t i,n,kmd_season; uint8_t pubkeys[64][33];
+    if ( (kmd_season= komodo_notaryseason(height,&timestamp)) != 0 )
+    {
+        *numnotariesp = NUM_KMD_NOTARIES;
+        return(komodo_seasonnotaryid(kmd_season,pubkey33));
+    }
     n = komodo_notaries(pubkeys,height,timestamp);
     *numnotariesp = n;
     for (i=0; i<n; i++)
@@ -123,7 +123,7 @@ struct komodo_state
     uint32_t SAVEDTIMESTAMP;
     uint64_t deposited,issued,withdrawn,approved,redeemed,shorted;
     struct notarized_checkpoint *NPOINTS; int32_t NUM_NPOINTS,last_NPOINTSi;
-    struct komodo_event **Komodo_events; int32_t Komodo_numevents;
+    struct komodo_event **Komodo_events; int32_t Komodo_numevents,Komodo_maxevents;
     uint32_t RTbufs[64][3]; uint64_t RTmask;
 };
 
@@ -26,6 +26,7 @@
 #include "addrman.h"
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockencodings.h"
 #include "importcoin.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -88,6 +89,9 @@ int32_t komodo_block2pubkey33(uint8_t *pubkey33,CBlock *block);
 bool Getscriptaddress(char *destaddr,const CScript &scriptPubKey);
 void komodo_setactivation(int32_t height);
 void komodo_pricesupdate(int32_t height,CBlock *pblock);
+void ClearTokensValidationCache();
+void ClearOraclesSampleCache();
+uint256 GetTokenIndexOutputs(const CTransaction &tx, std::vector<std::pair<int32_t, CTokenOutputValue>> &outputs, int64_t &supply);
 
 BlockMap mapBlockIndex;
 CChain chainActive;
@@ -100,9 +104,11 @@ bool fExperimentalMode = true;
 bool fImporting = false;
 bool fReindex = false;
 bool fTxIndex = false;
+bool fUtxoStatsIndex = DEFAULT_UTXOSTATSINDEX;
 bool fAddressIndex = false;
 bool fTimestampIndex = false;
 bool fSpentIndex = false;
+bool fTokenIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = true;
@@ -262,6 +268,7 @@ namespace {
         int64_t nTime;  //! Time of "getdata" request in microseconds.
         bool fValidatedHeaders;  //! Whether this block has validated headers at the time of request.
         int64_t nTimeDisconnect; //! The timeout for this block request (for disconnecting a slow peer)
+        std::shared_ptr<PartiallyDownloadedBlock> partialBlock;  //! Optional, used for CMPCTBLOCK downloads
     };
     map<uint256, pair<NodeId, list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
@@ -271,6 +278,9 @@ namespace {
     /** Number of preferable block download peers. */
     int nPreferredDownload = 0;
 
+    /** Outbound peers we asked to announce new blocks to us with cmpctblock. */
+    std::list<NodeId> lNodesAnnouncingHeaderAndIDs;
+
     /** Dirty block index entries. */
     set<CBlockIndex*> setDirtyBlockIndex;
 
@@ -325,6 +335,8 @@ namespace {
         int nBlocksInFlightValidHeaders;
         //! Whether we consider this a preferred download peer.
         bool fPreferredDownload;
+        //! Whether this peer will send us cmpctblocks if we request them.
+        bool fProvidesHeaderAndIDs;
 
         CNodeState() {
             fCurrentlyConnected = false;
@@ -338,6 +350,7 @@ namespace {
             nBlocksInFlight = 0;
             nBlocksInFlightValidHeaders = 0;
             fPreferredDownload = false;
+            fProvidesHeaderAndIDs = false;
         }
     };
 
@@ -397,6 +410,7 @@ namespace {
         BOOST_FOREACH(const QueuedBlock& entry, state->vBlocksInFlight)
         mapBlocksInFlight.erase(entry.hash);
         EraseOrphansFor(nodeid);
+        lNodesAnnouncingHeaderAndIDs.remove(nodeid);
         nPreferredDownload -= state->fPreferredDownload;
 
         mapNodeState.erase(nodeid);
@@ -432,7 +446,8 @@ namespace {
     }
 
     // Requires cs_main.
-    void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Params& consensusParams, CBlockIndex *pindex = NULL) {
+    // Returns the queue entry, so compact block downloads can attach their partial block to it.
+    list<QueuedBlock>::iterator MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Params& consensusParams, CBlockIndex *pindex = NULL) {
         CNodeState *state = State(nodeid);
         assert(state != NULL);
 
@@ -446,6 +461,7 @@ namespace {
         state->nBlocksInFlight++;
         state->nBlocksInFlightValidHeaders += newentry.fValidatedHeaders;
         mapBlocksInFlight[hash] = std::make_pair(nodeid, it);
+        return it;
     }
 
     /** Check whether the last unknown block a peer advertized is not yet known. */
@@ -602,6 +618,7 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
         if (queue.pindex)
             stats.vHeightInFlight.push_back(queue.pindex->GetHeight());
     }
+    stats.fProvidesHeaderAndIDs = state->fProvidesHeaderAndIDs;
     return true;
 }
 
@@ -1171,6 +1188,150 @@ bool ContextualCheckCoinbaseTransaction(int32_t slowflag,const CBlock *block,CBl
     return(true);
 }
 
+namespace {
+
+/**
+ * Transactions whose Sapling proofs and signatures were found valid, so that a
+ * transaction verified when it entered the mempool is not verified again when
+ * its block is connected. Entries are a salted hash of the txid, which commits
+ * to every proof and signature, and the signature hash, which commits to the
+ * consensus branch id.
+ */
+class CSaplingProofCache
+{
+private:
+    std::set<uint256> setValid;
+    uint256 salt;
+    CCriticalSection cs_saplingcache;
+
+    uint256 Key(const uint256 &txid, const uint256 &sighash) const
+    {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << salt << txid << sighash;
+        return ss.GetHash();
+    }
+
+public:
+    CSaplingProofCache() : salt(GetRandHash()) {}
+
+    bool Get(const uint256 &txid, const uint256 &sighash)
+    {
+        LOCK(cs_saplingcache);
+        return setValid.count(Key(txid, sighash)) != 0;
+    }
+
+    void Set(const uint256 &txid, const uint256 &sighash)
+    {
+        // A block holds a few hundred shielded transactions at most, so this
+        // covers a full mempool of them at 32 bytes per entry
+        const size_t nMaxCacheSize = 20000;
+        LOCK(cs_saplingcache);
+        while (setValid.size() >= nMaxCacheSize)
+        {
+            // Evict a random entry, as the signature cache does
+            std::set<uint256>::iterator it = setValid.lower_bound(GetRandHash());
+            if (it == setValid.end())
+                it = setValid.begin();
+            setValid.erase(it);
+        }
+        setValid.insert(Key(txid, sighash));
+    }
+};
+
+CSaplingProofCache saplingProofCache;
+
+enum SaplingProofResult
+{
+    SAPLING_PROOFS_VALID,
+    SAPLING_SPEND_INVALID,
+    SAPLING_OUTPUT_INVALID,
+    SAPLING_BINDING_SIG_INVALID
+};
+
+/**
+ * Verify the Sapling spend and output descriptions and the binding signature
+ * of a transaction. It is added to saplingProofCache only once all of them
+ * have been found valid.
+ */
+SaplingProofResult VerifySaplingProofs(const CTransaction &tx, const uint256 &dataToBeSigned)
+{
+    auto ctx = librustzcash_sapling_verification_ctx_init();
+
+    for (const SpendDescription &spend : tx.vShieldedSpend) {
+        if (!librustzcash_sapling_check_spend(
+            ctx,
+            spend.cv.begin(),
+            spend.anchor.begin(),
+            spend.nullifier.begin(),
+            spend.rk.begin(),
+            spend.zkproof.begin(),
+            spend.spendAuthSig.begin(),
+            dataToBeSigned.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return SAPLING_SPEND_INVALID;
+        }
+    }
+
+    for (const OutputDescription &output : tx.vShieldedOutput) {
+        if (!librustzcash_sapling_check_output(
+            ctx,
+            output.cv.begin(),
+            output.cm.begin(),
+            output.ephemeralKey.begin(),
+            output.zkproof.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return SAPLING_OUTPUT_INVALID;
+        }
+    }
+
+    if (!librustzcash_sapling_final_check(
+        ctx,
+        tx.valueBalance,
+        tx.bindingSig.begin(),
+        dataToBeSigned.begin()
+    ))
+    {
+        librustzcash_sapling_verification_ctx_free(ctx);
+        return SAPLING_BINDING_SIG_INVALID;
+    }
+
+    librustzcash_sapling_verification_ctx_free(ctx);
+    saplingProofCache.Set(tx.GetHash(), dataToBeSigned);
+    return SAPLING_PROOFS_VALID;
+}
+
+/**
+ * Closure verifying the Sapling proofs of one transaction of a block on the
+ * -par threads. It only fills saplingProofCache, ContextualCheckTransaction
+ * still runs on every transaction and reports the reason of a failure.
+ */
+class CSaplingCheck
+{
+private:
+    const CTransaction *ptx;
+    uint256 dataToBeSigned;
+
+public:
+    CSaplingCheck() : ptx(NULL) {}
+    CSaplingCheck(const CTransaction &txIn, const uint256 &dataToBeSignedIn) : ptx(&txIn), dataToBeSigned(dataToBeSignedIn) {}
+
+    bool operator()() { return VerifySaplingProofs(*ptx, dataToBeSigned) == SAPLING_PROOFS_VALID; }
+
+    void swap(CSaplingCheck &check) {
+        std::swap(ptx, check.ptx);
+        std::swap(dataToBeSigned, check.dataToBeSigned);
+    }
+};
+
+// A transaction takes milliseconds to verify, so workers take few at a time
+CCheckQueue<CSaplingCheck> saplingcheckqueue(8);
+
+}
+
 /**
  * Check a transaction contextually against a set of consensus rules valid at a given block height.
  *
@@ -1326,57 +1487,24 @@ bool ContextualCheckTransaction(int32_t slowflag,const CBlock *block, CBlockInde
                                 REJECT_INVALID, "bad-txns-invalid-script-data-for-coinbase-time-lock");
     }
 
-    if (!tx.vShieldedSpend.empty() ||
-        !tx.vShieldedOutput.empty())
+    if ((!tx.vShieldedSpend.empty() ||
+         !tx.vShieldedOutput.empty()) &&
+        !saplingProofCache.Get(tx.GetHash(), dataToBeSigned))
     {
-        auto ctx = librustzcash_sapling_verification_ctx_init();
-
-        for (const SpendDescription &spend : tx.vShieldedSpend) {
-            if (!librustzcash_sapling_check_spend(
-                ctx,
-                spend.cv.begin(),
-                spend.anchor.begin(),
-                spend.nullifier.begin(),
-                spend.rk.begin(),
-                spend.zkproof.begin(),
-                spend.spendAuthSig.begin(),
-                dataToBeSigned.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
+        switch (VerifySaplingProofs(tx, dataToBeSigned))
+        {
+            case SAPLING_SPEND_INVALID:
                 return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
                                       REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
-            }
-        }
-
-        for (const OutputDescription &output : tx.vShieldedOutput) {
-            if (!librustzcash_sapling_check_output(
-                ctx,
-                output.cv.begin(),
-                output.cm.begin(),
-                output.ephemeralKey.begin(),
-                output.zkproof.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
+            case SAPLING_OUTPUT_INVALID:
                 return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
                                       REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
-            }
-        }
-
-        if (!librustzcash_sapling_final_check(
-            ctx,
-            tx.valueBalance,
-            tx.bindingSig.begin(),
-            dataToBeSigned.begin()
-        ))
-        {
-            librustzcash_sapling_verification_ctx_free(ctx);
-            return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
-                                  REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+            case SAPLING_BINDING_SIG_INVALID:
+                return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
+                                      REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+            case SAPLING_PROOFS_VALID:
+                break;
         }
-
-        librustzcash_sapling_verification_ctx_free(ctx);
     }
     return true;
 }
@@ -2156,6 +2284,51 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return true;
 }
 
+bool GetTokenIndexBalance(const uint256 &tokenid, const CPubKey &pubkey, CAmount &balance)
+{
+    CTokenInfoValue info;
+    if (!fTokenIndex || !pblocktree->ReadTokenInfo(tokenid, info))
+        return false;
+
+    balance = 0;
+    pblocktree->ReadTokenBalance(CTokenBalanceKey(tokenid, pubkey), balance);
+
+    // outputs spent in the mempool are not available, every tx spending tokens has a token opret
+    std::vector<uint256> txids;
+    mempool.getCCIndex(txids, EVAL_TOKENS);
+    for (std::vector<uint256>::const_iterator it = txids.begin(); it != txids.end(); it++) {
+        CTransaction tx;
+        if (!mempool.lookup(*it, tx))
+            continue;
+        BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+            CTokenOutputValue value;
+            if (pblocktree->ReadTokenOutput(CTokenOutputKey(txin.prevout.hash, txin.prevout.n), value) &&
+                value.tokenid == tokenid && value.pubkey == pubkey)
+                balance -= value.satoshis;
+        }
+    }
+    return true;
+}
+
+bool GetTokenIndexInfo(const uint256 &tokenid, CTokenInfoValue &info)
+{
+    if (!fTokenIndex)
+        return false;
+
+    return pblocktree->ReadTokenInfo(tokenid, info);
+}
+
+bool GetTokenIndexList(std::vector<uint256> &tokenids)
+{
+    if (!fTokenIndex)
+        return error("token index not enabled");
+
+    if (!pblocktree->ReadTokenList(tokenids))
+        return error("unable to get token list");
+
+    return true;
+}
+
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
 {
@@ -2206,18 +2379,22 @@ struct CompareBlocksByHeightMain
     else return(coins.vout[n].nValue);
 }*/
 
+void CCreleaseinputs(const CTransaction &tx);
+
 bool myAddtomempool(CTransaction &tx, CValidationState *pstate, bool fSkipExpiry)
 {
     CValidationState state;
     if (!pstate)
         pstate = &state;
-    CTransaction Ltx; bool fMissingInputs,fOverrideFees = false;
+    CTransaction Ltx; bool fAccepted,fMissingInputs,fOverrideFees = false;
     if ( mempool.lookup(tx.GetHash(),Ltx) == 0 )
     {
         if ( !fSkipExpiry )
-            return(AcceptToMemoryPool(mempool, *pstate, tx, false, &fMissingInputs, !fOverrideFees, -1));
+            fAccepted = AcceptToMemoryPool(mempool, *pstate, tx, false, &fMissingInputs, !fOverrideFees, -1);
         else 
-            return(CCTxFixAcceptToMemPoolUnchecked(mempool,tx));
+            fAccepted = CCTxFixAcceptToMemPoolUnchecked(mempool,tx);
+        CCreleaseinputs(tx);
+        return(fAccepted);
     }
     else return(true);
 }
@@ -2300,8 +2477,8 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
     CBlockIndex *pindexSlow = NULL;
     memset(&hashBlock,0,sizeof(hashBlock));
 
-    LOCK(cs_main);
-
+    // The mempool, the tx index and the block files are safe to read without
+    // cs_main, only the slow path below needs the chain and the coins cache.
     if (mempool.lookup(hash, txOut))
     {
         return true;
@@ -2329,6 +2506,7 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
     }
 
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
+        LOCK(cs_main);
         int nHeight = -1;
         {
             CCoinsViewCache &view = *pcoinsTip;
@@ -2338,16 +2516,16 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
         }
         if (nHeight > 0)
             pindexSlow = chainActive[nHeight];
-    }
 
-    if (pindexSlow) {
-        CBlock block;
-        if (ReadBlockFromDisk(block, pindexSlow,1)) {
-            BOOST_FOREACH(const CTransaction &tx, block.vtx) {
-                if (tx.GetHash() == hash) {
-                    txOut = tx;
-                    hashBlock = pindexSlow->GetBlockHash();
-                    return true;
+        if (pindexSlow) {
+            CBlock block;
+            if (ReadBlockFromDisk(block, pindexSlow,1)) {
+                BOOST_FOREACH(const CTransaction &tx, block.vtx) {
+                    if (tx.GetHash() == hash) {
+                        txOut = tx;
+                        hashBlock = pindexSlow->GetBlockHash();
+                        return true;
+                    }
                 }
             }
         }
@@ -3165,6 +3343,99 @@ int8_t GetAddressType(const CScript &scriptPubKey, CTxDestination &vDest, txnout
     return keyType;
 }
 
+/**
+ * Applies the token outputs created and spent by a block to the token index, or takes them back
+ * when the block is disconnected. Must be called after the tx index of the block is written, as
+ * validating the token vouts loads the parent txs, which may be in the same block.
+ */
+static bool UpdateTokenIndex(const CBlock& block, int nHeight, bool fConnect)
+{
+    std::vector<std::pair<CTokenOutputKey, CTokenOutputValue> > outputs;
+    std::map<COutPoint, CTokenOutputValue> blockOutputs;
+    std::map<CTokenBalanceKey, CAmount> balanceDeltas;
+    std::map<uint256, CTokenInfoValue> created;
+
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction &tx = block.vtx[i];
+        const uint256 txid = tx.GetHash();
+
+        if (!tx.IsCoinBase()) {
+            BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+                CTokenOutputValue value;
+                std::map<COutPoint, CTokenOutputValue>::const_iterator it = blockOutputs.find(txin.prevout);
+                if (it != blockOutputs.end())
+                    value = it->second;
+                else if (!pblocktree->ReadTokenOutput(CTokenOutputKey(txin.prevout.hash, txin.prevout.n), value))
+                    continue;
+                balanceDeltas[CTokenBalanceKey(value.tokenid, value.pubkey)] += fConnect ? -value.satoshis : value.satoshis;
+            }
+        }
+
+        if (tx.vout.empty() || !tx.vout.back().scriptPubKey.IsOpReturn())
+            continue;
+        if (fConnect) {
+            std::vector<std::pair<int32_t, CTokenOutputValue> > vouts;
+            int64_t supply;
+            uint256 tokenid = GetTokenIndexOutputs(tx, vouts, supply);
+            if (tokenid.IsNull())
+                continue;
+            if (tokenid == txid)
+                created[tokenid] = CTokenInfoValue(supply, 0, nHeight);
+            for (unsigned int j = 0; j < vouts.size(); j++) {
+                const CTokenOutputValue &value = vouts[j].second;
+                outputs.push_back(make_pair(CTokenOutputKey(txid, vouts[j].first), value));
+                blockOutputs[COutPoint(txid, vouts[j].first)] = value;
+                balanceDeltas[CTokenBalanceKey(value.tokenid, value.pubkey)] += value.satoshis;
+            }
+        } else {
+            CTokenInfoValue info;
+            if (pblocktree->ReadTokenInfo(txid, info))
+                created[txid] = CTokenInfoValue();
+            for (unsigned int j = 0; j < tx.vout.size() - 1; j++) {
+                CTokenOutputValue value;
+                if (!pblocktree->ReadTokenOutput(CTokenOutputKey(txid, j), value))
+                    continue;
+                outputs.push_back(make_pair(CTokenOutputKey(txid, j), CTokenOutputValue()));
+                balanceDeltas[CTokenBalanceKey(value.tokenid, value.pubkey)] -= value.satoshis;
+            }
+        }
+    }
+
+    // count the holders whose balance appears or drops to zero
+    std::vector<std::pair<CTokenBalanceKey, CAmount> > balances;
+    std::map<uint256, int> holderDeltas;
+    for (std::map<CTokenBalanceKey, CAmount>::const_iterator it = balanceDeltas.begin(); it != balanceDeltas.end(); it++) {
+        if (it->second == 0)
+            continue;
+        CAmount balance = 0;
+        pblocktree->ReadTokenBalance(it->first, balance);
+        if (balance == 0)
+            holderDeltas[it->first.tokenid]++;
+        else if (balance + it->second == 0)
+            holderDeltas[it->first.tokenid]--;
+        balances.push_back(make_pair(it->first, balance + it->second));
+    }
+
+    std::vector<std::pair<uint256, CTokenInfoValue> > infos;
+    for (std::map<uint256, int>::const_iterator it = holderDeltas.begin(); it != holderDeltas.end(); it++) {
+        CTokenInfoValue info;
+        std::map<uint256, CTokenInfoValue>::const_iterator itCreated = created.find(it->first);
+        if (itCreated != created.end())
+            info = itCreated->second;
+        else if (!pblocktree->ReadTokenInfo(it->first, info))
+            continue;
+        if (info.IsNull())
+            continue;
+        info.holders += it->second;
+        infos.push_back(make_pair(it->first, info));
+    }
+    for (std::map<uint256, CTokenInfoValue>::const_iterator it = created.begin(); it != created.end(); it++)
+        if (it->second.IsNull() || holderDeltas.count(it->first) == 0)
+            infos.push_back(*it);
+
+    return pblocktree->UpdateTokenIndex(outputs, balances, infos);
+}
+
 bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
@@ -3312,6 +3583,10 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
         }
     }
 
+    if (fTokenIndex)
+        if (!UpdateTokenIndex(block, pindex->GetHeight(), false))
+            return AbortNode(state, "Failed to write token index");
+
     return fClean;
 }
 
@@ -3347,6 +3622,11 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+void ThreadSaplingCheck() {
+    RenameThread("zcash-saplingch");
+    saplingcheckqueue.Thread();
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -3857,6 +4137,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->UpdateSpentIndex(spentIndex))
             return AbortNode(state, "Failed to write transaction index");
 
+    if (fTokenIndex)
+        if (!UpdateTokenIndex(block, pindex->GetHeight(), true))
+            return AbortNode(state, "Failed to write token index");
+
     if (fTimestampIndex)
     {
         unsigned int logicalTS = pindex->nTime;
@@ -4020,6 +4304,200 @@ void FlushStateToDisk() {
         FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
 }
 
+CCoinsView *GetCoinsSnapshot() {
+    // Pins the coins database as of its last flush; the blocks connected
+    // since then are only in pcoinsTip and are not part of the snapshot.
+    LOCK(cs_main);
+    return pcoinsTip->CreateSnapshotView();
+}
+
+/** UTXO set statistics of the last block they were written for. */
+static CUtxoStats utxoStatsLast;
+/** Per-block changes of blocks connected while the parent had no statistics
+ *  yet, waiting for ThreadUtxoStats to build a starting point. */
+static std::map<uint256, CUtxoStats> mapUtxoStatsPending;
+/** More pending blocks than this means the builder fell far behind; it
+ *  starts over from a new snapshot instead. */
+static const size_t MAX_UTXOSTATS_PENDING = 1000;
+
+/**
+ * Record the UTXO set statistics after pindex. view is the per-block cache
+ * ConnectBlock filled, so its changes against pcoinsTip are exactly what the
+ * block did to the set. Entries are keyed by block hash; only the last
+ * MIN_BLOCKS_TO_KEEP blocks of the active chain are kept to serve reorgs,
+ * and DisconnectUtxoStatsIndex drops the entries of blocks reorged away.
+ */
+static void UpdateUtxoStatsIndex(const CBlockIndex *pindex, const CCoinsViewCache &view)
+{
+    AssertLockHeld(cs_main);
+    CUtxoStats delta;
+    view.UpdateUtxoStats(delta);
+
+    CUtxoStats stats;
+    const CBlockIndex *pprev = pindex->pprev;
+    bool fHaveParent = true;
+    if (pprev != NULL) {
+        if (utxoStatsLast.hashBlock == pprev->GetBlockHash())
+            stats = utxoStatsLast;
+        else
+            fHaveParent = pblocktree->ReadUtxoStats(pprev->GetBlockHash(), stats);
+    }
+    if (!fHaveParent) {
+        // ThreadUtxoStats only starts from a snapshot taken after the
+        // initial download, so there is no point keeping earlier blocks.
+        if (!IsInitialBlockDownload()) {
+            if (mapUtxoStatsPending.size() >= MAX_UTXOSTATS_PENDING)
+                mapUtxoStatsPending.clear();
+            mapUtxoStatsPending[pindex->GetBlockHash()] = delta;
+        }
+        return;
+    }
+    stats.Add(delta);
+    stats.hashBlock = pindex->GetBlockHash();
+    stats.nHeight = pindex->GetHeight();
+    if (!pblocktree->WriteUtxoStats(stats)) {
+        LogPrintf("%s: failed to write UTXO stats for %s\n", __func__, stats.hashBlock.ToString());
+        return;
+    }
+    utxoStatsLast = stats;
+    if (pindex->GetHeight() > MIN_BLOCKS_TO_KEEP)
+        pblocktree->EraseUtxoStats(pindex->GetAncestor(pindex->GetHeight() - MIN_BLOCKS_TO_KEEP)->GetBlockHash());
+}
+
+/** Forget the statistics of a disconnected block. The parent's entry is
+ *  still there, and if the block is connected again it is recomputed. */
+static void DisconnectUtxoStatsIndex(const CBlockIndex *pindex)
+{
+    AssertLockHeld(cs_main);
+    const uint256 hash = pindex->GetBlockHash();
+    mapUtxoStatsPending.erase(hash);
+    if (utxoStatsLast.hashBlock == hash)
+        utxoStatsLast = CUtxoStats();
+    if (!pblocktree->EraseUtxoStats(hash))
+        LogPrintf("%s: failed to erase UTXO stats for %s\n", __func__, hash.ToString());
+}
+
+bool GetUtxoStats(CUtxoStats &stats) {
+    LOCK(cs_main);
+    if (!fUtxoStatsIndex || chainActive.Tip() == NULL)
+        return false;
+    uint256 hashTip = chainActive.Tip()->GetBlockHash();
+    if (utxoStatsLast.hashBlock == hashTip) {
+        stats = utxoStatsLast;
+        return true;
+    }
+    return pblocktree->ReadUtxoStats(hashTip, stats);
+}
+
+bool GetUtxoStats(const uint256 &hashBlock, CUtxoStats &stats) {
+    LOCK(cs_main);
+    if (!fUtxoStatsIndex)
+        return false;
+    if (utxoStatsLast.hashBlock == hashBlock) {
+        stats = utxoStatsLast;
+        return true;
+    }
+    return pblocktree->ReadUtxoStats(hashBlock, stats);
+}
+
+/** Scan a snapshot of the UTXO set and bring the result up to the tip with
+ *  the pending per-block changes. Returns false if it has to be retried,
+ *  e.g. while the last flush is still older than the first pending block. */
+static bool BuildUtxoStats()
+{
+    CUtxoStats stats;
+    boost::scoped_ptr<CCoinsView> pview(GetCoinsSnapshot());
+    if (!pview || !pview->GetUtxoStats(stats))
+        return false;
+
+    LOCK(cs_main);
+    BlockMap::iterator mi = mapBlockIndex.find(stats.hashBlock);
+    if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second))
+        return false;
+    if (!pblocktree->WriteUtxoStats(stats))
+        return false;
+    for (CBlockIndex *pindex = chainActive.Next(mi->second); pindex != NULL; pindex = chainActive.Next(pindex)) {
+        std::map<uint256, CUtxoStats>::const_iterator it = mapUtxoStatsPending.find(pindex->GetBlockHash());
+        if (it == mapUtxoStatsPending.end()) {
+            // Connected on top of an entry written after our snapshot
+            // was taken; nothing left to fill in.
+            if (pblocktree->ReadUtxoStats(pindex->GetBlockHash(), stats))
+                break;
+            return false;
+        }
+        stats.Add(it->second);
+        stats.hashBlock = pindex->GetBlockHash();
+        stats.nHeight = pindex->GetHeight();
+        if (!pblocktree->WriteUtxoStats(stats))
+            return false;
+    }
+    utxoStatsLast = stats;
+    mapUtxoStatsPending.clear();
+    return true;
+}
+
+/** Recompute the statistics of a snapshot and compare them to the index. */
+static void CheckUtxoStats()
+{
+    CUtxoStats stats, indexed;
+    boost::scoped_ptr<CCoinsView> pview(GetCoinsSnapshot());
+    if (!pview || !pview->GetUtxoStats(stats))
+        return;
+    {
+        LOCK(cs_main);
+        if (!pblocktree->ReadUtxoStats(stats.hashBlock, indexed))
+            return;
+    }
+    if (stats.muhash.Finalize() != indexed.muhash.Finalize() ||
+        stats.nTransactions != indexed.nTransactions ||
+        stats.nTransactionOutputs != indexed.nTransactionOutputs ||
+        stats.nBogoSize != indexed.nBogoSize ||
+        stats.nTotalAmount != indexed.nTotalAmount) {
+        LogPrintf("ERROR: %s: UTXO stats index disagrees with the UTXO set at %s (height %d), rebuilding\n",
+                  __func__, stats.hashBlock.ToString(), stats.nHeight);
+        LOCK(cs_main);
+        pblocktree->WriteUtxoStats(stats);
+        if (utxoStatsLast.hashBlock == stats.hashBlock)
+            utxoStatsLast = stats;
+    } else {
+        LogPrint("bench", "%s: UTXO stats index verified at height %d\n", __func__, stats.nHeight);
+    }
+}
+
+/**
+ * Keeps the index usable for the life of the node: whenever the tip has no
+ * entry (the index was just enabled, or a reorg went past the kept entries)
+ * it is rebuilt from a snapshot, and once the tip has one, the pending
+ * changes of blocks that never got an entry are dropped.
+ */
+void ThreadUtxoStats()
+{
+    int64_t nCheckInterval = GetArg("-checkutxostats", 0) * 60 * 60;
+    int64_t nLastCheck = GetTime();
+    while (true) {
+        bool fHaveTip = false;
+        {
+            LOCK(cs_main);
+            CUtxoStats stats;
+            if (chainActive.Tip() != NULL && pblocktree->ReadUtxoStats(chainActive.Tip()->GetBlockHash(), stats)) {
+                // Every block connected from here on finds its parent's entry
+                utxoStatsLast = stats;
+                mapUtxoStatsPending.clear();
+                fHaveTip = true;
+            }
+        }
+        if (!fHaveTip && !IsInitialBlockDownload() && BuildUtxoStats()) {
+            LogPrintf("%s: UTXO stats index built\n", __func__);
+            fHaveTip = true;
+        }
+        if (fHaveTip && nCheckInterval > 0 && GetTime() - nLastCheck >= nCheckInterval) {
+            CheckUtxoStats();
+            nLastCheck = GetTime();
+        }
+        MilliSleep(10000);
+    }
+}
+
 void PruneAndFlush() {
     CValidationState state;
     fCheckForPruning = true;
@@ -4114,6 +4592,10 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
         assert(view.Flush());
         DisconnectNotarisations(block);
     }
+    if (fUtxoStatsIndex && KOMODO_NSPV_FULLNODE)
+        DisconnectUtxoStatsIndex(pindexDelete);
+    ClearTokensValidationCache();
+    ClearOraclesSampleCache();
     pindexDelete->segid = -2;
     pindexDelete->nNotaryPay = 0; 
     pindexDelete->newcoins = 0;
@@ -4300,6 +4782,8 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
             return error("ConnectTip(): ConnectBlock %s failed", pindexNew->GetBlockHash().ToString());
         }
         mapBlockSource.erase(pindexNew->GetBlockHash());
+        if (fUtxoStatsIndex && KOMODO_NSPV_FULLNODE)
+            UpdateUtxoStatsIndex(pindexNew, view);
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         LogPrint("bench", "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
         if ( KOMODO_NSPV_FULLNODE )
@@ -4642,10 +5126,33 @@ bool ActivateBestChain(bool fSkipdpow, CValidationState &state, CBlock *pblock)
             // Don't relay blocks if pruning -- could cause a peer to try to download, resulting
             // in a stalled download if the block file is pruned before the request.
             if (nLocalServices & NODE_NETWORK) {
+                // Peers that asked for high-bandwidth compact relay get the new tip pushed
+                // as a cmpctblock right away, everyone else gets the usual inv.
+                std::shared_ptr<CBlockHeaderAndShortTxIDs> pcmpctblock;
+                if (pblock != NULL && pblock->GetHash() == hashNewTip && pblock->vtx.size() > 0)
+                    pcmpctblock.reset(new CBlockHeaderAndShortTxIDs(*pblock));
                 LOCK(cs_vNodes);
                 BOOST_FOREACH(CNode* pnode, vNodes)
-                if (chainActive.Height() > (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : nBlockEstimate))
-                    pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
+                {
+                    if (chainActive.Height() <= (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : nBlockEstimate))
+                        continue;
+                    CInv inv(MSG_BLOCK, hashNewTip);
+                    if (pcmpctblock && pnode->fPreferHeaderAndIDs && pnode->nVersion >= SHORT_IDS_BLOCKS_VERSION)
+                    {
+                        bool fKnown;
+                        {
+                            LOCK(pnode->cs_inventory);
+                            fKnown = pnode->setInventoryKnown.count(inv) != 0;
+                        }
+                        if (!fKnown)
+                        {
+                            pnode->AddInventoryKnown(inv);
+                            pnode->PushMessage("cmpctblock", *pcmpctblock);
+                        }
+                        continue;
+                    }
+                    pnode->PushInventory(inv);
+                }
             }
             // Notify external listeners about the new tip.
             GetMainSignals().UpdatedBlockTip(pindexNewTip);
@@ -5425,6 +5932,31 @@ bool ContextualCheckBlock(int32_t slowflag,const CBlock& block, CValidationState
     const Consensus::Params& consensusParams = Params().GetConsensus();
     bool sapling = NetworkUpgradeActive(nHeight, consensusParams, Consensus::UPGRADE_SAPLING);
 
+    // Verify the Sapling proofs missing from saplingProofCache on the -par
+    // threads, so that the loop below finds them cached. A failure is left
+    // to ContextualCheckTransaction, which reports its reject reason.
+    if (sapling && nScriptCheckThreads)
+    {
+        auto consensusBranchId = CurrentEpochBranchId(nHeight, consensusParams);
+        CCheckQueueControl<CSaplingCheck> control(&saplingcheckqueue);
+        std::vector<CSaplingCheck> vChecks;
+        for (const CTransaction &tx : block.vtx)
+        {
+            if (tx.IsMint() || (tx.vShieldedSpend.empty() && tx.vShieldedOutput.empty()))
+                continue;
+            uint256 dataToBeSigned;
+            try {
+                dataToBeSigned = SignatureHash(CScript(), tx, NOT_AN_INPUT, SIGHASH_ALL, 0, consensusBranchId);
+            } catch (std::logic_error ex) {
+                continue;
+            }
+            if (!saplingProofCache.Get(tx.GetHash(), dataToBeSigned))
+                vChecks.push_back(CSaplingCheck(tx, dataToBeSigned));
+        }
+        control.Add(vChecks);
+        control.Wait();
+    }
+
     // Check that all transactions are finalized
     for (uint32_t i = 0; i < block.vtx.size(); i++) {
         const CTransaction& tx = block.vtx[i];
@@ -6210,6 +6742,10 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    // Check whether we have a token index
+    pblocktree->ReadFlag("tokenindex", fTokenIndex);
+    LogPrintf("%s: token index %s\n", __func__, fTokenIndex ? "enabled" : "disabled");
+
     // Fill in-memory data
     BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
     {
@@ -6575,6 +7111,9 @@ bool InitBlockIndex() {
         
         fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
         pblocktree->WriteFlag("spentindex", fSpentIndex);
+
+        fTokenIndex = GetBoolArg("-tokenindex", DEFAULT_TOKENINDEX);
+        pblocktree->WriteFlag("tokenindex", fTokenIndex);
         fprintf(stderr,"fAddressIndex.%d/%d fSpentIndex.%d/%d\n",fAddressIndex,DEFAULT_ADDRESSINDEX,fSpentIndex,DEFAULT_SPENTINDEX);
         LogPrintf("Initializing databases...\n");
     }
@@ -7010,8 +7549,6 @@ void static ProcessGetData(CNode* pfrom)
 
     vector<CInv> vNotFound;
 
-    LOCK(cs_main);
-
     while (it != pfrom->vRecvGetData.end()) {
         // Don't bother if send buffer is too full to respond anyway
         if (pfrom->nSendSize >= SendBufferSize())
@@ -7022,36 +7559,57 @@ void static ProcessGetData(CNode* pfrom)
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
             {
-                bool send = false;
-                BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
-                if (mi != mapBlockIndex.end())
+                // Only the index lookup needs cs_main. The block itself is read
+                // and serialized without it, so serving blocks to one peer does
+                // not stall validation or the other message handler threads.
+                bool send = false, fCompact = false;
+                int32_t nHeight = 0;
+                uint256 hashTip;
+                CDiskBlockPos pos;
                 {
-                    if (chainActive.Contains(mi->second)) {
-                        send = true;
-                    } else {
-                        static const int nOneMonth = 30 * 24 * 60 * 60;
-                        // To prevent fingerprinting attacks, only send blocks outside of the active
-                        // chain if they are valid, and no more than a month older (both in time, and in
-                        // best equivalent proof of work) than the best header chain we know about.
-                        send = mi->second->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
-                        (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
-                        (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, Params().GetConsensus()) < nOneMonth);
-                        if (!send) {
-                            LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+                    LOCK(cs_main);
+                    BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+                    if (mi != mapBlockIndex.end())
+                    {
+                        if (chainActive.Contains(mi->second)) {
+                            send = true;
+                        } else {
+                            static const int nOneMonth = 30 * 24 * 60 * 60;
+                            // To prevent fingerprinting attacks, only send blocks outside of the active
+                            // chain if they are valid, and no more than a month older (both in time, and in
+                            // best equivalent proof of work) than the best header chain we know about.
+                            send = mi->second->IsValid(BLOCK_VALID_SCRIPTS) && (pindexBestHeader != NULL) &&
+                            (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
+                            (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, Params().GetConsensus()) < nOneMonth);
+                            if (!send) {
+                                LogPrintf("%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+                            }
+                        }
+                        // Pruned nodes may have deleted the block, so check whether
+                        // it's available before trying to send.
+                        send = send && (mi->second->nStatus & BLOCK_HAVE_DATA);
+                        if (send)
+                        {
+                            pos = mi->second->GetBlockPos();
+                            nHeight = mi->second->GetHeight();
+                            // Only send a compact block for recent blocks, the sender will
+                            // most likely not have the transactions of older ones in its mempool.
+                            fCompact = nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH;
+                            hashTip = chainActive.Tip()->GetBlockHash();
                         }
                     }
                 }
-                // Pruned nodes may have deleted the block, so check whether
-                // it's available before trying to send.
-                if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
+                if (send)
                 {
                     // Send block from disk
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second,1))
+                    if (!ReadBlockFromDisk(nHeight, block, pos, 1) || block.GetHash() != inv.hash)
                     {
-                        assert(!"cannot load block from disk");
+                        // The block file may have been pruned since the lookup above
+                        LogPrintf("%s: cannot load block %s from disk for peer=%d\n", __func__, inv.hash.ToString(), pfrom->GetId());
+                        vNotFound.push_back(inv);
                     }
                     else
                     {
@@ -7064,6 +7622,16 @@ void static ProcessGetData(CNode* pfrom)
                             //fprintf(stderr," send block %d\n",komodo_block2height(&block));
                             pfrom->PushMessage("block", block);
                         }
+                        else if (inv.type == MSG_CMPCT_BLOCK)
+                        {
+                            if (fCompact)
+                            {
+                                CBlockHeaderAndShortTxIDs cmpctblock(block);
+                                pfrom->PushMessage("cmpctblock", cmpctblock);
+                            }
+                            else
+                                pfrom->PushMessage("block", block);
+                        }
                         else // MSG_FILTERED_BLOCK)
                         {
                             LOCK(pfrom->cs_filter);
@@ -7093,7 +7661,7 @@ void static ProcessGetData(CNode* pfrom)
                         // and we want it right after the last block so they don't
                         // wait for other stuff first.
                         vector<CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        vInv.push_back(CInv(MSG_BLOCK, hashTip));
                         pfrom->PushMessage("inv", vInv);
                         pfrom->hashContinue.SetNull();
                     }
@@ -7129,7 +7697,7 @@ void static ProcessGetData(CNode* pfrom)
             // Track requests for our stuff.
             GetMainSignals().Inventory(inv.hash);
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                 break;
         }
     }
@@ -7346,6 +7914,37 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             LOCK(cs_main);
             State(pfrom->GetId())->fCurrentlyConnected = true;
         }
+
+        if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION && !KOMODO_NSPV_SUPERLITE)
+        {
+            // Tell the peer we can rebuild blocks from short txids, and ask a few
+            // outbound peers to push new blocks to us as cmpctblock right away.
+            bool fAnnounceUsingCMPCTBLOCK = false;
+            uint64_t nCMPCTBLOCKVersion = 1;
+            if (!pfrom->fInbound)
+            {
+                LOCK(cs_main);
+                if (lNodesAnnouncingHeaderAndIDs.size() < MAX_CMPCTBLOCK_ANNOUNCING_PEERS)
+                {
+                    lNodesAnnouncingHeaderAndIDs.push_back(pfrom->GetId());
+                    fAnnounceUsingCMPCTBLOCK = true;
+                }
+            }
+            pfrom->PushMessage("sendcmpct", fAnnounceUsingCMPCTBLOCK, nCMPCTBLOCKVersion);
+        }
+    }
+
+    else if (strCommand == "sendcmpct")
+    {
+        bool fAnnounceUsingCMPCTBLOCK = false;
+        uint64_t nCMPCTBLOCKVersion = 0;
+        vRecv >> fAnnounceUsingCMPCTBLOCK >> nCMPCTBLOCKVersion;
+        if (nCMPCTBLOCKVersion == 1)
+        {
+            LOCK(cs_main);
+            State(pfrom->GetId())->fProvidesHeaderAndIDs = true;
+            pfrom->fPreferHeaderAndIDs = fAnnounceUsingCMPCTBLOCK;
+        }
     }
 
 
@@ -7399,9 +7998,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     LOCK(cs_vNodes);
                     // Use deterministic randomness to send to the same nodes for 24 hours
                     // at a time so the addrKnowns of the chosen nodes prevent repeats
-                    static uint256 hashSalt;
-                    if (hashSalt.IsNull())
-                        hashSalt = GetRandHash();
+                    // (initialized once, function statics are thread safe)
+                    static const uint256 hashSalt = GetRandHash();
                     uint64_t hashAddr = addr.GetHash();
                     uint256 hashRand = ArithToUint256(UintToArith256(hashSalt) ^ (hashAddr<<32) ^ ((GetTime()+hashAddr)/(24*60*60)));
                     hashRand = Hash(BEGIN(hashRand), END(hashRand));
@@ -7525,7 +8123,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         }
         pfrom->fSentAddr = true;
         
-        pfrom->vAddrToSend.clear();
+        {
+            LOCK(pfrom->cs_addrSend);
+            pfrom->vAddrToSend.clear();
+        }
         vector<CAddress> vAddr = addrman.GetAddr();
         BOOST_FOREACH(const CAddress &addr, vAddr)
         pfrom->PushAddress(addr);
@@ -7536,6 +8137,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         {
             std::vector<uint8_t> payload;
             vRecv >> payload;
+            // no cs_main here, each request locks only the chain lookups it makes
+            // so requests from different peers are served concurrently
             komodo_nSPVreq(pfrom,payload);
         }
         return(true);
@@ -7544,8 +8147,11 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     {
         if ( KOMODO_NSPV_SUPERLITE )
         {
+            // responses update the global NSPV_* results, handle one at a time
+            static CCriticalSection cs_nSPVresp;
             std::vector<uint8_t> payload;
             vRecv >> payload;
+            LOCK(cs_nSPVresp);
             komodo_nSPVresp(pfrom,payload);
         }
         return(true);
@@ -7594,7 +8200,12 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     CNodeState *nodestate = State(pfrom->GetId());
                     if (chainActive.Tip()->GetBlockTime() > GetTime() - chainparams.GetConsensus().nPowTargetSpacing * 20 &&
                         nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
-                        vToFetch.push_back(inv);
+                        // Near the tip the peer's block is most likely made of transactions
+                        // we already have, so ask for the compact form when it is supported.
+                        if (nodestate->fProvidesHeaderAndIDs)
+                            vToFetch.push_back(CInv(MSG_CMPCT_BLOCK, inv.hash));
+                        else
+                            vToFetch.push_back(inv);
                         // Mark block as in flight already, even though the actual "getdata" message only goes out
                         // later (within the same cs_main lock, though).
                         MarkBlockAsInFlight(pfrom->GetId(), inv.hash, chainparams.GetConsensus());
@@ -7996,6 +8607,229 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
+    else if (strCommand == "cmpctblock" && !fImporting && !fReindex) // Ignore compact blocks received while importing
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+
+        CBlock block;
+        bool fBlockReconstructed = false;
+        {
+            LOCK(cs_main);
+
+            if (mapBlockIndex.find(cmpctblock.header.hashPrevBlock) == mapBlockIndex.end())
+            {
+                // Doesn't connect (or is genesis), instead of DoSing in AcceptBlockHeader, request deeper headers
+                if (!IsInitialBlockDownload())
+                    pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), uint256());
+                return true;
+            }
+
+            CBlockIndex *pindex = NULL;
+            CValidationState state;
+            int32_t futureblock = 0;
+            if (!AcceptBlockHeader(&futureblock, cmpctblock.header, state, &pindex))
+            {
+                int nDoS;
+                if (state.IsInvalid(nDoS) && futureblock == 0)
+                {
+                    if (nDoS > 0)
+                        Misbehaving(pfrom->GetId(), nDoS/nDoS);
+                    return error("invalid header received via cmpctblock from peer=%d", pfrom->id);
+                }
+            }
+            if (pindex == NULL)
+                return true;
+
+            uint256 hash = pindex->GetBlockHash();
+            pfrom->AddInventoryKnown(CInv(MSG_BLOCK, hash));
+            UpdateBlockAvailability(pfrom->GetId(), hash);
+
+            // Nothing to do if we already have the block
+            if (pindex->nStatus & BLOCK_HAVE_DATA)
+                return true;
+
+            map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator blockInFlightIt = mapBlocksInFlight.find(hash);
+            if (blockInFlightIt != mapBlocksInFlight.end() && blockInFlightIt->second.first != pfrom->GetId())
+            {
+                // Someone else is already sending us this block
+                return true;
+            }
+
+            list<QueuedBlock>::iterator queuedIt;
+            if (blockInFlightIt != mapBlocksInFlight.end())
+                queuedIt = blockInFlightIt->second.second;
+            else
+                queuedIt = MarkBlockAsInFlight(pfrom->GetId(), hash, chainparams.GetConsensus(), pindex);
+
+            if (pindex->pprev != chainActive.Tip())
+            {
+                // Not a direct successor of our tip, our mempool will not help much: fetch the whole block
+                vector<CInv> vInv(1, CInv(MSG_BLOCK, hash));
+                pfrom->PushMessage("getdata", vInv);
+                return true;
+            }
+
+            queuedIt->partialBlock.reset(new PartiallyDownloadedBlock(&mempool));
+            PartiallyDownloadedBlock& partialBlock = *queuedIt->partialBlock;
+            ReadStatus status = partialBlock.InitData(cmpctblock);
+            if (status == READ_STATUS_INVALID)
+            {
+                MarkBlockAsReceived(hash); // Reset in-flight state in case of whitelist
+                Misbehaving(pfrom->GetId(), 100);
+                return error("peer=%d sent us invalid compact block", pfrom->id);
+            }
+            else if (status == READ_STATUS_FAILED)
+            {
+                // Duplicate txindexes, the block is now in-flight, so just request it
+                queuedIt->partialBlock.reset();
+                vector<CInv> vInv(1, CInv(MSG_BLOCK, hash));
+                pfrom->PushMessage("getdata", vInv);
+                return true;
+            }
+
+            BlockTransactionsRequest req;
+            for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++)
+            {
+                if (!partialBlock.IsTxAvailable(i))
+                    req.indexes.push_back(i);
+            }
+            if (!req.indexes.empty())
+            {
+                req.blockhash = hash;
+                pfrom->PushMessage("getblocktxn", req);
+                return true;
+            }
+
+            // Every transaction was in our mempool, the block is complete
+            std::vector<CTransaction> dummy;
+            status = partialBlock.FillBlock(block, dummy);
+            if (status != READ_STATUS_OK)
+            {
+                queuedIt->partialBlock.reset();
+                vector<CInv> vInv(1, CInv(MSG_BLOCK, hash));
+                pfrom->PushMessage("getdata", vInv);
+                return true;
+            }
+            fBlockReconstructed = true;
+        }
+
+        if (fBlockReconstructed)
+        {
+            CValidationState state;
+            ProcessNewBlock(0,0,state, pfrom, &block, false, NULL);
+            int nDoS;
+            if (state.IsInvalid(nDoS)) {
+                pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
+                                   state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), block.GetHash());
+                if (nDoS > 0) {
+                    LOCK(cs_main);
+                    Misbehaving(pfrom->GetId(), nDoS);
+                }
+            }
+        }
+    }
+
+
+    else if (strCommand == "getblocktxn")
+    {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        LOCK(cs_main);
+
+        BlockMap::iterator it = mapBlockIndex.find(req.blockhash);
+        if (it == mapBlockIndex.end() || !(it->second->nStatus & BLOCK_HAVE_DATA))
+        {
+            LogPrint("net", "peer=%d sent us a getblocktxn for a block we don't have\n", pfrom->id);
+            return true;
+        }
+
+        if (it->second->GetHeight() < chainActive.Height() - MAX_BLOCKTXN_DEPTH)
+        {
+            // If an older block is requested (should never happen in practice,
+            // but can happen in tests) send a block response instead of a
+            // blocktxn response. Sending a full block response instead of a
+            // small blocktxn response is preferable in the case where a peer
+            // might maliciously send lots of getblocktxn requests to trigger
+            // expensive disk reads, because it will require the peer to
+            // actually receive all the data read from disk over the network.
+            LogPrint("net", "peer=%d sent us a getblocktxn for a block > %i deep\n", pfrom->id, MAX_BLOCKTXN_DEPTH);
+            pfrom->vRecvGetData.push_back(CInv(MSG_BLOCK, req.blockhash));
+            ProcessGetData(pfrom);
+            return true;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, it->second, 1))
+        {
+            // our block file is missing or damaged, which is not the peer's fault
+            LogPrintf("%s: failed to read block %s for getblocktxn from peer=%d\n", __func__, req.blockhash.ToString(), pfrom->id);
+            return true;
+        }
+
+        BlockTransactions resp(req);
+        for (size_t i = 0; i < req.indexes.size(); i++)
+        {
+            if (req.indexes[i] >= block.vtx.size())
+            {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("peer=%d sent us a getblocktxn with out-of-bounds tx indices", pfrom->id);
+            }
+            resp.txn[i] = block.vtx[req.indexes[i]];
+        }
+        pfrom->PushMessage("blocktxn", resp);
+    }
+
+
+    else if (strCommand == "blocktxn" && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        CBlock block;
+        {
+            LOCK(cs_main);
+
+            map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator it = mapBlocksInFlight.find(resp.blockhash);
+            if (it == mapBlocksInFlight.end() || !it->second.second->partialBlock ||
+                it->second.first != pfrom->GetId())
+            {
+                LogPrint("net", "peer=%d sent us block transactions for block we weren't expecting\n", pfrom->id);
+                return true;
+            }
+
+            ReadStatus status = it->second.second->partialBlock->FillBlock(block, resp.txn);
+            if (status == READ_STATUS_INVALID)
+            {
+                MarkBlockAsReceived(resp.blockhash); // Reset in-flight state in case of whitelist
+                Misbehaving(pfrom->GetId(), 100);
+                return error("peer=%d sent us invalid compact block/non-matching block transactions", pfrom->id);
+            }
+            else if (status == READ_STATUS_FAILED)
+            {
+                // Might have collided, fall back to getdata now :(
+                it->second.second->partialBlock.reset();
+                vector<CInv> vInv(1, CInv(MSG_BLOCK, resp.blockhash));
+                pfrom->PushMessage("getdata", vInv);
+                return true;
+            }
+        }
+
+        CValidationState state;
+        ProcessNewBlock(0,0,state, pfrom, &block, false, NULL);
+        int nDoS;
+        if (state.IsInvalid(nDoS)) {
+            pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
+                               state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), resp.blockhash);
+            if (nDoS > 0) {
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), nDoS);
+            }
+        }
+    }
+
+
     else if (strCommand == "mempool")
     {
         LOCK2(cs_main, pfrom->cs_filter);
@@ -8169,7 +9003,11 @@ bool ProcessMessages(CNode* pfrom)
     bool fOk = true;
 
     if (!pfrom->vRecvGetData.empty())
+    {
+        int64_t nTimeStart = GetTimeMicros();
         ProcessGetData(pfrom);
+        pfrom->RecordMsgProcessTime("getdata", GetTimeMicros() - nTimeStart);
+    }
 
     // this maintains the order of responses
     if (!pfrom->vRecvGetData.empty()) return fOk;
@@ -8227,6 +9065,7 @@ bool ProcessMessages(CNode* pfrom)
 
         // Process message
         bool fRet = false;
+        int64_t nTimeStart = GetTimeMicros();
         try
         {
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
@@ -8258,6 +9097,7 @@ bool ProcessMessages(CNode* pfrom)
         } catch (...) {
             PrintExceptionContinue(NULL, "ProcessMessages()");
         }
+        pfrom->RecordMsgProcessTime(SanitizeString(strCommand), GetTimeMicros() - nTimeStart);
 
         if (!fRet)
             LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
@@ -8323,7 +9163,10 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             {
                 // Periodically clear addrKnown to allow refresh broadcasts
                 if (nLastRebroadcast)
+                {
+                    LOCK(pnode->cs_addrSend);
                     pnode->addrKnown.reset();
+                }
 
                 // Rebroadcast our address
                 AdvertizeLocal(pnode);
@@ -8338,24 +9181,22 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         if (fSendTrickle)
         {
             vector<CAddress> vAddr;
-            vAddr.reserve(pto->vAddrToSend.size());
-            BOOST_FOREACH(const CAddress& addr, pto->vAddrToSend)
             {
-                if (!pto->addrKnown.contains(addr.GetKey()))
+                LOCK(pto->cs_addrSend);
+                vAddr.reserve(pto->vAddrToSend.size());
+                BOOST_FOREACH(const CAddress& addr, pto->vAddrToSend)
                 {
-                    pto->addrKnown.insert(addr.GetKey());
-                    vAddr.push_back(addr);
-                    // receiver rejects addr messages larger than 1000
-                    if (vAddr.size() >= 1000)
+                    if (!pto->addrKnown.contains(addr.GetKey()))
                     {
-                        pto->PushMessage("addr", vAddr);
-                        vAddr.clear();
+                        pto->addrKnown.insert(addr.GetKey());
+                        vAddr.push_back(addr);
                     }
                 }
+                pto->vAddrToSend.clear();
             }
-            pto->vAddrToSend.clear();
-            if (!vAddr.empty())
-                pto->PushMessage("addr", vAddr);
+            // receiver rejects addr messages larger than 1000
+            for (size_t i = 0; i < vAddr.size(); i += 1000)
+                pto->PushMessage("addr", vector<CAddress>(vAddr.begin() + i, vAddr.begin() + std::min(vAddr.size(), i + 1000)));
         }
 
         CNodeState &state = *State(pto->GetId());
@@ -8423,9 +9264,7 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                 if (inv.type == MSG_TX && !fSendTrickle)
                 {
                     // 1/4 of tx invs blast to all immediately
-                    static uint256 hashSalt;
-                    if (hashSalt.IsNull())
-                        hashSalt = GetRandHash();
+                    static const uint256 hashSalt = GetRandHash();
                     uint256 hashRand = ArithToUint256(UintToArith256(inv.hash) ^ UintToArith256(hashSalt));
                     hashRand = Hash(BEGIN(hashRand), END(hashRand));
                     bool fTrickleWait = ((UintToArith256(hashRand) & 3) != 0);
@@ -41,6 +41,7 @@
 #include "spentindex.h"
 #include "sync.h"
 #include "tinyformat.h"
+#include "tokenindex.h"
 #include "txmempool.h"
 #include "uint256.h"
 
@@ -107,6 +108,13 @@ static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 160;
+/** Maximum depth of blocks we're willing to serve as compact blocks to peers
+ *  when requested. For older blocks, a regular BLOCK response will be sent. */
+static const int MAX_CMPCTBLOCK_DEPTH = 5;
+/** Maximum depth of blocks we're willing to respond to GETBLOCKTXN requests for. */
+static const int MAX_BLOCKTXN_DEPTH = 10;
+/** Maximum number of outbound peers we ask to push new blocks to us as cmpctblock announcements. */
+static const unsigned int MAX_CMPCTBLOCK_ANNOUNCING_PEERS = 3;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
@@ -125,6 +133,8 @@ static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 #define DEFAULT_ADDRESSINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 #define DEFAULT_SPENTINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 static const bool DEFAULT_TIMESTAMPINDEX = false;
+static const bool DEFAULT_UTXOSTATSINDEX = false;
+static const bool DEFAULT_TOKENINDEX = false;
 static const unsigned int DEFAULT_DB_MAX_OPEN_FILES = 1000;
 static const bool DEFAULT_DB_COMPRESSION = true;
 
@@ -157,6 +167,8 @@ extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+extern bool fUtxoStatsIndex;
+extern bool fTokenIndex;
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
@@ -239,6 +251,8 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the Sapling proof checking thread */
+void ThreadSaplingCheck();
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -287,6 +301,18 @@ void Misbehaving(NodeId nodeid, int howmuch);
 void FlushStateToDisk();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
+/** Return a read-only view of the UTXO set as of the last flush of the coins
+ *  cache that can be queried without cs_main, or NULL. Caller owns it. */
+CCoinsView *GetCoinsSnapshot();
+/** Copy the incrementally maintained UTXO set statistics of the current tip
+ *  (-utxostatsindex). Returns false while they are still being built. */
+bool GetUtxoStats(CUtxoStats &stats);
+/** Same for the block hashBlock, as long as it is among the last
+ *  MIN_BLOCKS_TO_KEEP blocks the index keeps. */
+bool GetUtxoStats(const uint256 &hashBlock, CUtxoStats &stats);
+/** Build the UTXO set statistics of the tip if they are missing, then
+ *  optionally recompute and cross-check them every -checkutxostats hours. */
+void ThreadUtxoStats();
 
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
@@ -298,6 +324,7 @@ struct CNodeStateStats {
     int nSyncHeight;
     int nCommonHeight;
     std::vector<int> vHeightInFlight;
+    bool fProvidesHeaderAndIDs;
 };
 
 struct CTimestampIndexIteratorKey {
@@ -797,6 +824,10 @@ public:
 
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+/** Confirmed token balance of a pubkey from the token index, less the outputs spent in the mempool */
+bool GetTokenIndexBalance(const uint256 &tokenid, const CPubKey &pubkey, CAmount &balance);
+bool GetTokenIndexInfo(const uint256 &tokenid, CTokenInfoValue &info);
+bool GetTokenIndexList(std::vector<uint256> &tokenids);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                      int start = 0, int end = 0);
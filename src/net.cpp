@@ -37,8 +37,11 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
+#include <unordered_map>
+
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 
@@ -65,6 +68,12 @@ using namespace std;
 namespace {
     const int MAX_OUTBOUND_CONNECTIONS = 16;
     const int MAX_INBOUND_FROMIP = 5;
+    // Maximum number of queued messages handed to a single gather write.
+    const size_t MAX_SEND_IOVECS = 64;
+#ifdef USE_EPOLL
+    // Maximum number of readiness events collected per epoll_wait call.
+    const int MAX_EPOLL_EVENTS = 1024;
+#endif
 
     struct ListenSocket {
         SOCKET socket;
@@ -90,6 +99,9 @@ static bool vfLimited[NET_MAX] = {};
 static CNode* pnodeLocalHost = NULL;
 uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
+#ifdef USE_EPOLL
+static SOCKET hEpoll = INVALID_SOCKET; // readiness set of ThreadSocketHandler, created on its first pass
+#endif
 CAddrMan addrman;
 int nMaxConnections = DEFAULT_MAX_PEER_CONNECTIONS;
 bool fAddressesInitialized = false;
@@ -116,6 +128,7 @@ CCriticalSection cs_nLastNodeId;
 
 static CSemaphore *semOutbound = NULL;
 static boost::condition_variable messageHandlerCondition;
+static boost::mutex messageHandlerMutex;
 
 // Signals for message handling
 static CNodeSignals g_signals;
@@ -604,6 +617,24 @@ void CNode::copyStats(CNodeStats &stats, const std::vector<bool> &m_asmap)
 
     // Leave string empty if addrLocal invalid (not filled in yet)
     stats.addrLocal = addrLocal.IsValid() ? addrLocal.ToString() : "";
+
+    {
+        LOCK(cs_msgStats);
+        stats.mapRecvCountPerMsgCmd = mapRecvCountPerMsgCmd;
+        stats.mapProcessTimePerMsgCmd = mapProcessTimePerMsgCmd;
+    }
+}
+
+void CNode::RecordMsgProcessTime(const std::string &strCommand, int64_t nTimeUsec)
+{
+    LOCK(cs_msgStats);
+    // Commands are chosen by the peer, so lump unknown ones together once
+    // the map is full instead of letting it grow without bound.
+    std::string strKey = strCommand;
+    if (!mapProcessTimePerMsgCmd.count(strKey) && mapProcessTimePerMsgCmd.size() >= MAX_MSGCMD_STATS)
+        strKey = "*other*";
+    mapProcessTimePerMsgCmd[strKey] += (nTimeUsec > 0 ? nTimeUsec : 0);
+    mapRecvCountPerMsgCmd[strKey]++;
 }
 
 // requires LOCK(cs_vRecvMsg)
@@ -699,6 +730,59 @@ void SocketSendData(CNode *pnode)
 {
     std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
 
+#ifndef _WIN32
+    // Hand as many queued messages as possible to the kernel in a single
+    // gather write, straight out of vSendMsg.
+    while (it != pnode->vSendMsg.end()) {
+        struct iovec iov[MAX_SEND_IOVECS];
+        size_t nIov = 0, nQueued = 0, nOffset = pnode->nSendOffset;
+        for (std::deque<CSerializeData>::iterator jt = it; jt != pnode->vSendMsg.end() && nIov < MAX_SEND_IOVECS; jt++) {
+            assert(jt->size() > nOffset);
+            iov[nIov].iov_base = (void *)&(*jt)[nOffset];
+            iov[nIov].iov_len = jt->size() - nOffset;
+            nQueued += iov[nIov].iov_len;
+            nOffset = 0;
+            nIov++;
+        }
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = nIov;
+        ssize_t nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (nBytes > 0) {
+            pnode->nLastSend = GetTime();
+            pnode->nSendBytes += nBytes;
+            pnode->RecordBytesSent(nBytes);
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                size_t nRemaining = it->size() - pnode->nSendOffset;
+                if (nLeft < nRemaining) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nRemaining;
+                pnode->nSendOffset = 0;
+                pnode->nSendSize -= it->size();
+                it++;
+            }
+            if ((size_t)nBytes < nQueued) {
+                // could not send everything; the socket buffer is full
+                break;
+            }
+        } else {
+            if (nBytes < 0) {
+                // error
+                int nErr = WSAGetLastError();
+                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+                {
+                    LogPrintf("socket send error %s\n", NetworkErrorString(nErr));
+                    pnode->CloseSocketDisconnect();
+                }
+            }
+            // couldn't send anything at all
+            break;
+        }
+    }
+#else
     while (it != pnode->vSendMsg.end()) {
         const CSerializeData &data = *it;
         assert(data.size() > pnode->nSendOffset);
@@ -730,6 +814,7 @@ void SocketSendData(CNode *pnode)
             break;
         }
     }
+#endif
 
     if (it == pnode->vSendMsg.end()) {
         assert(pnode->nSendOffset == 0);
@@ -1085,6 +1170,102 @@ void ThreadSocketHandler()
             uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
+#ifdef USE_EPOLL
+        //
+        // Update the epoll interest set: only sockets whose wanted events changed
+        // since the last iteration cost a syscall, and epoll_wait only reports
+        // the sockets that are actually ready.
+        //
+        if (hEpoll == INVALID_SOCKET)
+        {
+            hEpoll = epoll_create1(EPOLL_CLOEXEC);
+            if (hEpoll == INVALID_SOCKET)
+            {
+                LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(WSAGetLastError()));
+                MilliSleep(50);
+                continue;
+            }
+            BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+                struct epoll_event event = {};
+                event.events = EPOLLIN;
+                event.data.fd = hListenSocket.socket;
+                if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hListenSocket.socket, &event) == SOCKET_ERROR)
+                    LogPrintf("epoll_ctl failed for listening socket: %s\n", NetworkErrorString(WSAGetLastError()));
+            }
+        }
+
+        {
+            LOCK(cs_vNodes);
+            BOOST_FOREACH(CNode* pnode, vNodes)
+            {
+                if (pnode->hSocket == INVALID_SOCKET)
+                    continue;
+
+                // Same policy as the select() path below: drain the send queue
+                // first, otherwise read unless the receive buffer is full.
+                // EPOLLERR and EPOLLHUP are always reported.
+                uint32_t nEvents = 0;
+                bool fWantSend = false;
+                {
+                    TRY_LOCK(pnode->cs_vSend, lockSend);
+                    fWantSend = lockSend && !pnode->vSendMsg.empty();
+                }
+                if (fWantSend)
+                    nEvents = EPOLLOUT;
+                else
+                {
+                    TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+                    if (lockRecv && (
+                        pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
+                        nEvents = EPOLLIN;
+                }
+
+                if (pnode->fEpollRegistered && pnode->nEpollEvents == nEvents)
+                    continue;
+                struct epoll_event event = {};
+                event.events = nEvents;
+                event.data.fd = pnode->hSocket;
+                if (epoll_ctl(hEpoll, pnode->fEpollRegistered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, pnode->hSocket, &event) == SOCKET_ERROR)
+                {
+                    LogPrint("net", "epoll_ctl failed for peer=%d: %s\n", pnode->id, NetworkErrorString(WSAGetLastError()));
+                    continue;
+                }
+                pnode->fEpollRegistered = true;
+                pnode->nEpollEvents = nEvents;
+            }
+        }
+
+        struct epoll_event events[MAX_EPOLL_EVENTS];
+        int nEvents = epoll_wait(hEpoll, events, MAX_EPOLL_EVENTS, 50); // frequency to poll pnode->vSend
+        boost::this_thread::interruption_point();
+
+        std::unordered_map<SOCKET, uint32_t> mapReady;
+        if (nEvents == SOCKET_ERROR)
+        {
+            int nErr = WSAGetLastError();
+            if (nErr != WSAEINTR)
+                LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            MilliSleep(50);
+        }
+        else
+        {
+            mapReady.reserve(nEvents);
+            for (int i = 0; i < nEvents; i++)
+                mapReady[events[i].data.fd] = events[i].events;
+        }
+
+        //
+        // Accept new connections
+        //
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+        {
+            if (hListenSocket.socket != INVALID_SOCKET && mapReady.count(hListenSocket.socket))
+            {
+                AcceptConnection(hListenSocket);
+            }
+        }
+#else
         //
         // Find which sockets have data to receive
         //
@@ -1177,6 +1358,7 @@ void ThreadSocketHandler()
                 AcceptConnection(hListenSocket);
             }
         }
+#endif
 
         //
         // Service each socket
@@ -1197,7 +1379,20 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
+#ifdef USE_EPOLL
+            uint32_t nReady = 0;
+            {
+                std::unordered_map<SOCKET, uint32_t>::const_iterator itReady = mapReady.find(pnode->hSocket);
+                if (itReady != mapReady.end())
+                    nReady = itReady->second;
+            }
+            bool fRecvReady = (nReady & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0;
+            bool fSendReady = (nReady & EPOLLOUT) != 0;
+#else
+            bool fRecvReady = FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError);
+            bool fSendReady = FD_ISSET(pnode->hSocket, &fdsetSend);
+#endif
+            if (fRecvReady)
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv)
@@ -1241,7 +1436,7 @@ void ThreadSocketHandler()
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend))
+            if (fSendReady)
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
                 if (lockSend)
@@ -1572,11 +1767,11 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant *grantOu
 }
 
 
+// Several of these threads may run at once. A peer's messages are only ever
+// processed by the thread holding its cs_vRecvMsg, so they are still handled
+// one at a time and in order, while different peers proceed in parallel.
 void ThreadMessageHandler()
 {
-    boost::mutex condition_mutex;
-    boost::unique_lock<boost::mutex> lock(condition_mutex);
-
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true)
     {
@@ -1596,26 +1791,30 @@ void ThreadMessageHandler()
 
         bool fSleep = true;
 
-        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+        // Start at a random peer so that concurrent handler threads spread
+        // out over the peer list rather than queueing on the same locks.
+        size_t nStart = vNodesCopy.empty() ? 0 : GetRand(vNodesCopy.size());
+        for (size_t i = 0; i < vNodesCopy.size(); i++)
         {
+            CNode* pnode = vNodesCopy[(nStart + i) % vNodesCopy.size()];
             if (pnode->fDisconnect)
                 continue;
 
+            // Holding cs_vRecvMsg for both receiving and sending keeps all
+            // work for this peer on one thread at a time.
+            TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+            if (!lockRecv)
+                continue;
+
             // Receive messages
+            if (!g_signals.ProcessMessages(pnode))
+                pnode->CloseSocketDisconnect();
+
+            if (pnode->nSendSize < SendBufferSize())
             {
-                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                if (lockRecv)
+                if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
                 {
-                    if (!g_signals.ProcessMessages(pnode))
-                        pnode->CloseSocketDisconnect();
-
-                    if (pnode->nSendSize < SendBufferSize())
-                    {
-                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete()))
-                        {
-                            fSleep = false;
-                        }
-                    }
+                    fSleep = false;
                 }
             }
             boost::this_thread::interruption_point();
@@ -1636,7 +1835,10 @@ void ThreadMessageHandler()
         }
 
         if (fSleep)
+        {
+            boost::unique_lock<boost::mutex> lock(messageHandlerMutex);
             messageHandlerCondition.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100));
+        }
     }
 }
 
@@ -1840,7 +2042,11 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
 
     // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    int nMsgHandlerThreads = GetArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS);
+    nMsgHandlerThreads = std::max(1, std::min(nMsgHandlerThreads, MAX_MSGHANDLER_THREADS));
+    LogPrintf("Using %d message handler threads\n", nMsgHandlerThreads);
+    for (int i = 0; i < nMsgHandlerThreads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
 
     // Dump network addresses
     scheduler.scheduleEvery(&DumpAddresses, DUMP_ADDRESSES_INTERVAL);
@@ -1877,6 +2083,10 @@ public:
             if (hListenSocket.socket != INVALID_SOCKET)
                 if (!CloseSocket(hListenSocket.socket))
                     LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
+#ifdef USE_EPOLL
+        if (hEpoll != INVALID_SOCKET)
+            CloseSocket(hEpoll);
+#endif
 
         // clean up some globals (to help leak detection)
         BOOST_FOREACH(CNode *pnode, vNodes)
@@ -2128,11 +2338,14 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
+    fEpollRegistered = false;
+    nEpollEvents = 0;
     hashContinue = uint256();
     nStartingHeight = -1;
     fGetAddr = false;
     fRelayTxes = false;
     fSentAddr = false;
+    fPreferHeaderAndIDs = false;
     pfilter = new CBloomFilter();
     nPingNonceSent = 0;
     nPingUsecStart = 0;
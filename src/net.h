@@ -75,6 +75,12 @@ static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 static const size_t SETASKFOR_MAX_SZ = 2 * MAX_INV_SZ;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 384;
+/** Default number of threads processing peer messages (-msghandlerthreads) */
+static const int DEFAULT_MSGHANDLER_THREADS = 4;
+/** Maximum number of threads processing peer messages */
+static const int MAX_MSGHANDLER_THREADS = 16;
+/** Maximum number of distinct commands tracked in a peer's processing time stats */
+static const size_t MAX_MSGCMD_STATS = 64;
 /** The period before a network upgrade activates, where connections to upgrading peers are preferred (in blocks). */
 static const int NETWORK_UPGRADE_PEER_PREFERENCE_BLOCK_PERIOD = 24 * 24 * 3;
 
@@ -188,6 +194,8 @@ struct LocalServiceInfo {
 extern CCriticalSection cs_mapLocalHost;
 extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
+typedef std::map<std::string, uint64_t> mapMsgCmdSize; //command, total
+
 class CNodeStats
 {
 public:
@@ -213,6 +221,9 @@ public:
     // Bind address of our side of the connection
     // CAddress addrBind; // https://github.com/bitcoin/bitcoin/commit/a7e3c2814c8e49197889a4679461be42254e5c51
     uint32_t m_mapped_as;
+    // Number of messages and time spent processing them (usec), per command
+    mapMsgCmdSize mapRecvCountPerMsgCmd;
+    mapMsgCmdSize mapProcessTimePerMsgCmd;
 };
 
 
@@ -273,6 +284,10 @@ public:
     uint64_t nSendBytes;
     std::deque<CSerializeData> vSendMsg;
     CCriticalSection cs_vSend;
+    // Events hSocket is currently registered for in the socket handler's epoll set,
+    // only touched by ThreadSocketHandler and unused without USE_EPOLL.
+    bool fEpollRegistered;
+    uint32_t nEpollEvents;
 
     std::deque<CInv> vRecvGetData;
     std::deque<CNetMessage> vRecvMsg;
@@ -311,6 +326,9 @@ public:
     //    until it has initialized its bloom filter.
     bool fRelayTxes;
     bool fSentAddr;
+    // Set when the peer asked (via sendcmpct) to be sent new tip blocks as
+    // cmpctblock messages instead of inv announcements.
+    bool fPreferHeaderAndIDs;
     CSemaphoreGrant grantOutbound;
     CCriticalSection cs_filter;
     CBloomFilter* pfilter;
@@ -336,6 +354,9 @@ public:
     int nStartingHeight;
 
     // flood relay
+    // vAddrToSend and addrKnown are filled by whichever message handler
+    // thread relays an address to this peer, so they are guarded by cs_addrSend
+    CCriticalSection cs_addrSend;
     std::vector<CAddress> vAddrToSend;
     CRollingBloomFilter addrKnown;
     bool fGetAddr;
@@ -360,6 +381,11 @@ public:
     // Whether a ping is requested.
     bool fPingQueued;
 
+    // Message processing stats, per command
+    CCriticalSection cs_msgStats;
+    mapMsgCmdSize mapRecvCountPerMsgCmd;
+    mapMsgCmdSize mapProcessTimePerMsgCmd;
+
     CNode(SOCKET hSocketIn, const CAddress &addrIn, const std::string &addrNameIn = "", bool fInboundIn = false);
     ~CNode();
 
@@ -397,6 +423,9 @@ public:
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes);
 
+    // Account nTimeUsec spent processing a strCommand message from this peer
+    void RecordMsgProcessTime(const std::string &strCommand, int64_t nTimeUsec);
+
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int nVersionIn)
     {
@@ -420,6 +449,7 @@ public:
 
     void AddAddressKnown(const CAddress& addr)
     {
+        LOCK(cs_addrSend);
         addrKnown.insert(addr.GetKey());
     }
 
@@ -428,6 +458,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_addrSend);
         if (addr.IsValid() && !addrKnown.contains(addr.GetKey())) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand() % vAddrToSend.size()] = addr;
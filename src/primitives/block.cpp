@@ -125,7 +125,7 @@ uint256 CBlockHeader::GetVerusEntropyHash(int32_t height) const
     return GetHash();
 }
 
-uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
+uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> &leaves,
         std::vector<uint256> &vMerkleTree)
 {
     /* WARNING! If you're reading this because you're learning about crypto
@@ -249,7 +249,7 @@ public:
 };
 
 
-uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
+uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> &leaves,
         std::vector<uint256> &vMerkleTree);
 
 std::vector<uint256> GetMerkleBranch(int nIndex, int nLeaves, const std::vector<uint256> &vMerkleTree);
@@ -39,6 +39,8 @@
 
 #include <stdint.h>
 
+#include <boost/scoped_ptr.hpp>
+
 #include <univalue.h>
 
 #include <regex>
@@ -395,43 +397,31 @@ bool NSPV_inmempool(uint256 txid);
 
 bool myIsutxo_spentinmempool(uint256 &spenttxid,int32_t &spentvini,uint256 txid,int32_t vout)
 {
-    int32_t vini = 0;
     if ( KOMODO_NSPV_SUPERLITE )
         return(NSPV_spentinmempool(spenttxid,spentvini,txid,vout));
-    BOOST_FOREACH(const CTxMemPoolEntry &e,mempool.mapTx)
-    {
-        const CTransaction &tx = e.GetTx();
-        const uint256 &hash = tx.GetHash();
-        BOOST_FOREACH(const CTxIn &txin,tx.vin)
-        {
-            //fprintf(stderr,"%s/v%d ",uint256_str(str,txin.prevout.hash),txin.prevout.n);
-            if ( txin.prevout.n == vout && txin.prevout.hash == txid )
-            {
-                spenttxid = hash;
-                spentvini = vini;
-                return(true);
-            }
-            vini++;
-        }
-        //fprintf(stderr,"are vins for %s\n",uint256_str(str,hash));
-    }
-    return(false);
+    return(mempool.getSpender(COutPoint(txid,vout),spenttxid,spentvini));
 }
 
-bool mytxid_inmempool(uint256 txid)
+int32_t myIsutxos_spentinmempool(std::vector<bool> &spent,const std::vector<COutPoint> &outpoints)
 {
+    int32_t n = 0;
     if ( KOMODO_NSPV_SUPERLITE )
     {
-        
-    }
-    BOOST_FOREACH(const CTxMemPoolEntry &e,mempool.mapTx)
-    {
-        const CTransaction &tx = e.GetTx();
-        const uint256 &hash = tx.GetHash();
-        if ( txid == hash )
-            return(true);
+        uint256 spenttxid; int32_t spentvini;
+        spent.resize(outpoints.size());
+        for (size_t i=0; i<outpoints.size(); i++)
+            spent[i] = NSPV_spentinmempool(spenttxid,spentvini,outpoints[i].hash,outpoints[i].n);
     }
-    return(false);
+    else mempool.getSpent(outpoints,spent);
+    for (size_t i=0; i<spent.size(); i++)
+        if ( spent[i] )
+            n++;
+    return(n);
+}
+
+bool mytxid_inmempool(uint256 txid)
+{
+    return(mempool.exists(txid));
 }
 
 UniValue mempoolToJSON(bool fVerbose = false)
@@ -891,39 +881,81 @@ UniValue getblock(const UniValue& params, bool fHelp, const CPubKey& mypk)
     return blockToJSON(block, pblockindex, verbosity >= 2);
 }
 
+/** The RPC reports the set at the tip, so flush the coins cache first. Holding
+ *  cs_main keeps a new tip from being connected before the snapshot is taken. */
+static CCoinsView *GetCoinsSnapshotAtTip()
+{
+    LOCK(cs_main);
+    FlushStateToDisk();
+    return GetCoinsSnapshot();
+}
+
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
-    if (fHelp || params.size() != 0)
+    if (fHelp || params.size() > 1)
         throw runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time, unless hash_type is \"muhash\".\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"         (string, optional, default=\"hash_serialized\") \"hash_serialized\" scans the whole set,\n"
+            "                         \"muhash\" returns the statistics kept by -utxostatsindex without scanning\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
             "  \"transactions\": n,      (numeric) The number of transactions\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
-            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
+            "  \"bytes_serialized\": n,  (numeric) The serialized size (hash_serialized only)\n"
+            "  \"hash_serialized\": \"hash\",   (string) The serialized hash (hash_serialized only)\n"
+            "  \"bogosize\": n,          (numeric) A meaningless metric for UTXO set size (muhash only)\n"
+            "  \"muhash\": \"hash\",      (string) The order independent hash of the set, if -utxostatsindex has it\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\"")
             + HelpExampleRpc("gettxoutsetinfo", "")
         );
 
+    std::string strHashType = params.size() > 0 ? params[0].get_str() : "hash_serialized";
+    if (strHashType != "muhash" && strHashType != "hash_serialized")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "hash_type must be \"hash_serialized\" or \"muhash\"");
+
     UniValue ret(UniValue::VOBJ);
 
+    if (strHashType == "muhash") {
+        // Fall back to scanning a snapshot while the index is being built
+        CUtxoStats stats;
+        if (!GetUtxoStats(stats)) {
+            boost::scoped_ptr<CCoinsView> pview(GetCoinsSnapshotAtTip());
+            if (!pview || !pview->GetUtxoStats(stats))
+                return ret;
+        }
+        ret.push_back(Pair("height", (int64_t)stats.nHeight));
+        ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
+        ret.push_back(Pair("transactions", (int64_t)stats.nTransactions));
+        ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
+        ret.push_back(Pair("bogosize", (int64_t)stats.nBogoSize));
+        ret.push_back(Pair("muhash", stats.muhash.Finalize().GetHex()));
+        ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
+        return ret;
+    }
+
+    // The UTXO set is scanned from a database snapshot, so blocks keep
+    // being connected while the statistics are computed.
     CCoinsStats stats;
-    FlushStateToDisk();
-    if (pcoinsTip->GetStats(stats)) {
+    boost::scoped_ptr<CCoinsView> pview(GetCoinsSnapshotAtTip());
+    if (pview && pview->GetStats(stats)) {
         ret.push_back(Pair("height", (int64_t)stats.nHeight));
         ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
         ret.push_back(Pair("transactions", (int64_t)stats.nTransactions));
         ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
         ret.push_back(Pair("bytes_serialized", (int64_t)stats.nSerializedSize));
         ret.push_back(Pair("hash_serialized", stats.hashSerialized.GetHex()));
+        CUtxoStats utxostats;
+        if (GetUtxoStats(stats.hashBlock, utxostats))
+            ret.push_back(Pair("muhash", utxostats.muhash.Finalize().GetHex()));
         ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
     }
     return ret;
@@ -936,7 +968,7 @@ UniValue kvsearch(const UniValue& params, bool fHelp, const CPubKey& mypk)
     if (fHelp || params.size() != 1 )
         throw runtime_error(
             "kvsearch key\n"
-            "\nSearch for a key stored via the kvupdate command. This feature is only available for asset chains.\n"
+            "\nSearch for a key stored via the kvupdate command, including updates still in the mempool. This feature is only available for asset chains.\n"
             "\nArguments:\n"
             "1. key                      (string, required) search the chain for this key\n"
             "\nResult:\n"
@@ -966,7 +998,7 @@ UniValue kvsearch(const UniValue& params, bool fHelp, const CPubKey& mypk)
         if ( keylen < sizeof(key) )
         {
             memcpy(key,params[0].get_str().c_str(),keylen);
-            if ( (valuesize= komodo_kvsearch(&refpubkey,chainActive.LastTip()->GetHeight(),&flags,&height,value,key,keylen)) >= 0 )
+            if ( (valuesize= komodo_kvsearch_mempool(&refpubkey,chainActive.LastTip()->GetHeight(),&flags,&height,value,key,keylen)) >= 0 )
             {
                 std::string val; char *valuestr;
                 val.resize(valuesize);
@@ -986,6 +1018,57 @@ UniValue kvsearch(const UniValue& params, bool fHelp, const CPubKey& mypk)
     return ret;
 }
 
+UniValue kvlist(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    UniValue ret(UniValue::VARR); uint32_t flags; uint8_t value[IGUANA_MAXSCRIPTSIZE*8],prefix[IGUANA_MAXSCRIPTSIZE*8]; int32_t i,height,valuesize,prefixlen = 0,currentheight; uint256 refpubkey; static uint256 zeroes; std::vector<std::string> keys;
+    if (fHelp || params.size() > 1 )
+        throw runtime_error(
+            "kvlist ( \"prefix\" )\n"
+            "\nList the keys stored via the kvupdate command that have not expired, including updates still in the mempool. This feature is only available for asset chains.\n"
+            "\nArguments:\n"
+            "1. prefix                   (string, optional) only list keys starting with this prefix\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"key\": \"xxxxx\",         (string) key\n"
+            "    \"owner\": \"xxxxx\"        (string) hex string representing the owner of the key \n"
+            "    \"height\": xxxxx,          (numeric) height the key was stored at\n"
+            "    \"expiration\": xxxxx,      (numeric) height the key will expire\n"
+            "    \"flags\": x                (numeric) 1 if the key was created with a password; 0 otherwise.\n"
+            "    \"value\": \"xxxxx\",       (string) stored value\n"
+            "    \"valuesize\": xxxxx        (string) amount of characters stored\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("kvlist", "examplekey")
+            + HelpExampleRpc("kvlist", "\"examplekey\"")
+        );
+    if ( params.size() > 0 && (prefixlen= (int32_t)params[0].get_str().size()) >= sizeof(prefix) )
+        throw runtime_error("prefix too big\n");
+    if ( prefixlen > 0 )
+        memcpy(prefix,params[0].get_str().c_str(),prefixlen);
+    LOCK(cs_main);
+    currentheight = chainActive.LastTip()->GetHeight();
+    komodo_kvlist(keys,currentheight,prefix,prefixlen);
+    for (i=0; i<keys.size(); i++)
+    {
+        // the entry can expire or be purged between the listing and the search
+        if ( (valuesize= komodo_kvsearch_mempool(&refpubkey,currentheight,&flags,&height,value,(uint8_t *)keys[i].data(),(int32_t)keys[i].size())) < 0 )
+            continue;
+        UniValue item(UniValue::VOBJ);
+        item.push_back(Pair("key",keys[i]));
+        if ( memcmp(&zeroes,&refpubkey,sizeof(refpubkey)) != 0 )
+            item.push_back(Pair("owner",refpubkey.GetHex()));
+        item.push_back(Pair("height",height));
+        item.push_back(Pair("expiration",komodo_kvexpiry(height,flags)));
+        item.push_back(Pair("flags",(int64_t)flags));
+        item.push_back(Pair("value",std::string((char *)value,valuesize)));
+        item.push_back(Pair("valuesize",valuesize));
+        ret.push_back(item);
+    }
+    return ret;
+}
+
 UniValue minerids(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     uint32_t timestamp = 0; UniValue ret(UniValue::VOBJ); UniValue a(UniValue::VARR); uint8_t minerids[2000],pubkeys[65][33]; int32_t i,j,n,numnotaries,tally[129];
@@ -107,7 +107,15 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
             "    \"inflight\": [\n"
             "       n,                        (numeric) The heights of blocks we're currently asking from this peer\n"
             "       ...\n"
-            "    ]\n"
+            "    ],\n"
+            "    \"compactblocks\": true|false, (boolean) Whether the peer relays blocks to us as compact blocks\n"
+            "    \"whitelisted\": true|false, (boolean) Whether the peer is whitelisted\n"
+            "    \"msgproctime\": {           (json object) Messages received from the peer, per command\n"
+            "       \"command\": {\n"
+            "         \"count\": n,            (numeric) The number of messages processed\n"
+            "         \"usec\": n              (numeric) The total time spent processing them, in microseconds\n"
+            "       }, ...\n"
+            "    }\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -162,9 +170,20 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
                 heights.push_back(height);
             }
             obj.push_back(Pair("inflight", heights));
+            obj.push_back(Pair("compactblocks", statestats.fProvidesHeaderAndIDs));
         }
         obj.push_back(Pair("whitelisted", stats.fWhitelisted));
 
+        UniValue msgproctime(UniValue::VOBJ);
+        BOOST_FOREACH(const mapMsgCmdSize::value_type &i, stats.mapProcessTimePerMsgCmd) {
+            UniValue cmd(UniValue::VOBJ);
+            mapMsgCmdSize::const_iterator itCount = stats.mapRecvCountPerMsgCmd.find(i.first);
+            cmd.push_back(Pair("count", itCount != stats.mapRecvCountPerMsgCmd.end() ? itCount->second : 0));
+            cmd.push_back(Pair("usec", i.second));
+            msgproctime.push_back(Pair(i.first, cmd));
+        }
+        obj.push_back(Pair("msgproctime", msgproctime));
+
         ret.push_back(obj);
     }
 
@@ -1330,6 +1330,7 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp, const CPubKey& m
 }
 
 extern UniValue NSPV_broadcast(char *hex);
+void CCreleaseinputs(const CTransaction &tx);
 
 UniValue sendrawtransaction(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
@@ -1376,7 +1377,10 @@ UniValue sendrawtransaction(const UniValue& params, bool fHelp, const CPubKey& m
             // push to local node and sync with wallets
             CValidationState state;
             bool fMissingInputs;
-            if (!AcceptToMemoryPool(mempool, state, tx, false, &fMissingInputs, !fOverrideFees)) {
+            bool fAccepted = AcceptToMemoryPool(mempool, state, tx, false, &fMissingInputs, !fOverrideFees);
+            // either the mempool now guards the inputs of a CC tx or they are free for another one
+            CCreleaseinputs(tx);
+            if (!fAccepted) {
                 if (state.IsInvalid()) {
                     throw JSONRPCError(RPC_TRANSACTION_REJECTED, strprintf("%i: %s", state.GetRejectCode(), state.GetRejectReason()));
                 } else {
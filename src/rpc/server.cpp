@@ -341,6 +341,7 @@ static const CRPCCommand vRPCCommands[] =
     //{ "blockchain",         "txMoMproof",             &txMoMproof,             true  },
     { "blockchain",         "minerids",               &minerids,               true  },
     { "blockchain",         "kvsearch",               &kvsearch,               true  },
+    { "blockchain",         "kvlist",                 &kvlist,                 true  },
     { "blockchain",         "kvupdate",               &kvupdate,               true  },
 
     /* Cross chain utilities */
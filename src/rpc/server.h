@@ -524,6 +524,7 @@ extern UniValue migrate_createnotaryapprovaltransaction(const UniValue& params,
 extern UniValue notaries(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue minerids(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue kvsearch(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue kvlist(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue kvupdate(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue paxprice(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue paxpending(const UniValue& params, bool fHelp, const CPubKey& mypk);
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include "key.h"
+#include "main.h"
+#include "script/standard.h"
+
+#include "testutils.h"
+
+
+int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block);
+
+
+namespace TestConnectBlock {
+
+
+    /*
+     * A block with a coinbase and a notarisation of KMD in position 1,
+     * optionally followed by a change output after the opreturn.
+     */
+    CBlock notarisationBlock(bool withChange)
+    {
+        CKey key;
+        key.MakeNewKey(true);
+
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vin[0].prevout.SetNull();
+        coinbase.vout.resize(1);
+        coinbase.vout[0].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+        coinbase.vout[0].nValue = 1;
+
+        // block hash, notarised height, desttxid, symbol
+        std::vector<uint8_t> opret(32 + 4 + 32);
+        opret[32] = 1;
+        opret.insert(opret.end(), {'K', 'M', 'D', 0});
+
+        CMutableTransaction notarisation;
+        notarisation.vout.resize(2);
+        notarisation.vout[0].scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+        notarisation.vout[0].nValue = 1;
+        notarisation.vout[1].scriptPubKey = CScript() << OP_RETURN << opret;
+        if (withChange) {
+            notarisation.vout.resize(3);
+            notarisation.vout[2].scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+            notarisation.vout[2].nValue = 1;
+        }
+
+        CBlock block;
+        block.vtx.push_back(CTransaction(coinbase));
+        block.vtx.push_back(CTransaction(notarisation));
+        return block;
+    }
+
+
+    TEST(TestConnectBlock, testNotarisationPosition)
+    {
+        setupChain();
+        generateBlock();
+
+        CBlock block = notarisationBlock(false);
+        EXPECT_EQ(1, komodo_connectblock(true, chainActive.LastTip(), block));
+    }
+
+
+    TEST(TestConnectBlock, testOutputsAfterNotarisationOpret)
+    {
+        setupChain();
+        generateBlock();
+
+        // every output after a matched notarisation opret counts as another notarisation
+        CBlock block = notarisationBlock(true);
+        EXPECT_EQ(-1, komodo_connectblock(true, chainActive.LastTip(), block));
+    }
+
+
+} /* namespace TestConnectBlock */
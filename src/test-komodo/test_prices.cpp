@@ -0,0 +1,228 @@
+#include <gtest/gtest.h>
+#include <gmp.h>
+
+#include "cc/CCPrices.h"
+
+
+int32_t prices_syntheticop(uint16_t opcode, int64_t *pricestack, int32_t &depth);
+
+
+namespace TestPrices {
+
+
+    /*
+     * The GMP arithmetic prices_syntheticprice() used for the operators before
+     * it switched to 128 bit integers. Sets divzero instead of dividing by zero.
+     */
+    int32_t gmpSyntheticOp(uint16_t opcode, int64_t *pricestack, int32_t &depth, bool &divzero)
+    {
+        int32_t errcode = 0;
+        int64_t a, b, c;
+        mpz_t mpzA, mpzB, mpzC, mpzResult;
+
+        mpz_init(mpzA);
+        mpz_init(mpzB);
+        mpz_init(mpzC);
+        mpz_init(mpzResult);
+        divzero = false;
+
+        switch (opcode & KOMODO_PRICEMASK)
+        {
+        case PRICES_MULT:
+            b = pricestack[--depth];
+            a = pricestack[--depth];
+            mpz_set_si(mpzA, a);
+            mpz_set_si(mpzB, b);
+            mpz_mul(mpzResult, mpzA, mpzB);
+            mpz_tdiv_q_ui(mpzResult, mpzResult, SATOSHIDEN);
+            pricestack[depth++] = mpz_get_si(mpzResult);
+            break;
+
+        case PRICES_DIV:
+            b = pricestack[--depth];
+            a = pricestack[--depth];
+            mpz_set_si(mpzA, a);
+            mpz_set_si(mpzB, b);
+            mpz_mul_ui(mpzResult, mpzA, SATOSHIDEN);
+            if (!(divzero = mpz_sgn(mpzB) == 0))
+                mpz_tdiv_q(mpzResult, mpzResult, mpzB);
+            pricestack[depth++] = mpz_get_si(mpzResult);
+            break;
+
+        case PRICES_INV:
+            a = pricestack[--depth];
+            mpz_set_si(mpzA, a);
+            mpz_set_ui(mpzResult, SATOSHIDEN);
+            mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);
+            if (!(divzero = mpz_sgn(mpzA) == 0))
+                mpz_tdiv_q(mpzResult, mpzResult, mpzA);
+            pricestack[depth++] = mpz_get_si(mpzResult);
+            break;
+
+        case PRICES_MDD:
+            c = pricestack[--depth];
+            b = pricestack[--depth];
+            a = pricestack[--depth];
+            mpz_set_si(mpzA, a);
+            mpz_set_si(mpzB, b);
+            mpz_set_si(mpzC, c);
+            mpz_mul_ui(mpzResult, mpzA, SATOSHIDEN);
+            if (!(divzero = mpz_sgn(mpzB) == 0 || mpz_sgn(mpzC) == 0)) {
+                mpz_tdiv_q(mpzResult, mpzResult, mpzB);
+                mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);
+                mpz_tdiv_q(mpzResult, mpzResult, mpzC);
+            }
+            pricestack[depth++] = mpz_get_si(mpzResult);
+            break;
+
+        case PRICES_MMD:
+            c = pricestack[--depth];
+            b = pricestack[--depth];
+            a = pricestack[--depth];
+            mpz_set_si(mpzA, a);
+            mpz_set_si(mpzB, b);
+            mpz_set_si(mpzC, c);
+            mpz_mul(mpzResult, mpzA, mpzB);
+            if (!(divzero = mpz_sgn(mpzC) == 0))
+                mpz_tdiv_q(mpzResult, mpzResult, mpzC);
+            pricestack[depth++] = mpz_get_si(mpzResult);
+            break;
+
+        case PRICES_MMM:
+            c = pricestack[--depth];
+            b = pricestack[--depth];
+            a = pricestack[--depth];
+            mpz_set_si(mpzA, a);
+            mpz_set_si(mpzB, b);
+            mpz_set_si(mpzC, c);
+            mpz_mul(mpzResult, mpzA, mpzB);
+            mpz_tdiv_q_ui(mpzResult, mpzResult, SATOSHIDEN);
+            mpz_mul(mpzResult, mpzResult, mpzC);
+            mpz_tdiv_q_ui(mpzResult, mpzResult, SATOSHIDEN);
+            pricestack[depth++] = mpz_get_si(mpzResult);
+            break;
+
+        case PRICES_DDD:
+            c = pricestack[--depth];
+            b = pricestack[--depth];
+            a = pricestack[--depth];
+            mpz_set_si(mpzA, a);
+            mpz_set_si(mpzB, b);
+            mpz_set_si(mpzC, c);
+            mpz_set_ui(mpzResult, SATOSHIDEN);
+            mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);
+            if (!(divzero = mpz_sgn(mpzA) == 0)) {
+                mpz_tdiv_q(mpzResult, mpzResult, mpzA);
+                mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);
+                if (!(divzero = mpz_sgn(mpzB) == 0)) {
+                    mpz_tdiv_q(mpzResult, mpzResult, mpzB);
+                    mpz_mul_ui(mpzResult, mpzResult, SATOSHIDEN);
+                    if (!(divzero = mpz_sgn(mpzC) == 0))
+                        mpz_tdiv_q(mpzResult, mpzResult, mpzC);
+                }
+            }
+            pricestack[depth++] = mpz_get_si(mpzResult);
+            break;
+        }
+
+        if (mpz_cmp_si(mpzResult, std::numeric_limits<int64_t>::max()) > 0)
+            errcode = -13;
+
+        mpz_clear(mpzResult);
+        mpz_clear(mpzA);
+        mpz_clear(mpzB);
+        mpz_clear(mpzC);
+        return errcode;
+    }
+
+
+    const int64_t operands[] = {
+        0, 1, 2, 7, 99999999, 100000000, 100000001, 123456789012, 92233720368, 92233720369,
+        3037000499, 3037000500, std::numeric_limits<int64_t>::max() - 1, std::numeric_limits<int64_t>::max(),
+        -1, -100000000, -987654321, std::numeric_limits<int64_t>::min() + 1, std::numeric_limits<int64_t>::min()
+    };
+
+
+    /*
+     * Every combination of operands, including ones that give zero or
+     * negative intermediates and results at and past INT64_MAX
+     */
+    void checkOperator(uint16_t opcode, int32_t arity)
+    {
+        const int32_t n = sizeof(operands) / sizeof(operands[0]);
+        int32_t checked = 0;
+
+        for (int32_t i = 0; i < n; i++)
+        for (int32_t j = 0; j < (arity > 1 ? n : 1); j++)
+        for (int32_t k = 0; k < (arity > 2 ? n : 1); k++)
+        {
+            int64_t args[3] = { operands[i], operands[j], operands[k] };
+            int64_t expected[4], actual[4];
+            int32_t expectedDepth = arity, actualDepth = arity;
+            bool divzero;
+
+            memcpy(expected, args, sizeof(args));
+            memcpy(actual, args, sizeof(args));
+            int32_t expectedErr = gmpSyntheticOp(opcode, expected, expectedDepth, divzero);
+            if (divzero)
+                continue;
+            int32_t actualErr = prices_syntheticop(opcode, actual, actualDepth);
+
+            ASSERT_EQ(expectedErr, actualErr) << "opcode " << opcode << " " << args[0] << " " << args[1] << " " << args[2];
+            if (expectedErr == 0) {
+                ASSERT_EQ(expectedDepth, actualDepth);
+                ASSERT_EQ(expected[0], actual[0]) << "opcode " << opcode << " " << args[0] << " " << args[1] << " " << args[2];
+            }
+            checked++;
+        }
+        EXPECT_GT(checked, 0);
+    }
+
+
+    TEST(TestPrices, testMult) { checkOperator(PRICES_MULT, 2); }
+    TEST(TestPrices, testDiv) { checkOperator(PRICES_DIV, 2); }
+    TEST(TestPrices, testInv) { checkOperator(PRICES_INV, 1); }
+    TEST(TestPrices, testMDD) { checkOperator(PRICES_MDD, 3); }
+    TEST(TestPrices, testMMD) { checkOperator(PRICES_MMD, 3); }
+    TEST(TestPrices, testMMM) { checkOperator(PRICES_MMM, 3); }
+    TEST(TestPrices, testDDD) { checkOperator(PRICES_DDD, 3); }
+
+
+    TEST(TestPrices, testOverflowBoundary)
+    {
+        const int64_t max = std::numeric_limits<int64_t>::max();
+        int64_t stack[4];
+        int32_t depth;
+
+        // INT64_MAX itself is a valid price, one more is an overflow
+        stack[0] = max; stack[1] = SATOSHIDEN; depth = 2;
+        EXPECT_EQ(0, prices_syntheticop(PRICES_MULT, stack, depth));
+        EXPECT_EQ(max, stack[0]);
+        stack[0] = max; stack[1] = SATOSHIDEN + 1; depth = 2;
+        EXPECT_EQ(-13, prices_syntheticop(PRICES_MULT, stack, depth));
+
+        stack[0] = max; stack[1] = SATOSHIDEN; stack[2] = SATOSHIDEN; depth = 3;
+        EXPECT_EQ(0, prices_syntheticop(PRICES_MMM, stack, depth));
+        EXPECT_EQ(max, stack[0]);
+        stack[0] = max; stack[1] = max; stack[2] = max; depth = 3;
+        EXPECT_EQ(-13, prices_syntheticop(PRICES_MMM, stack, depth));
+    }
+
+
+    TEST(TestPrices, testStackErrors)
+    {
+        int64_t stack[4] = { 1, 1, 1, 1 };
+        int32_t depth;
+
+        depth = 1; EXPECT_EQ(-3, prices_syntheticop(PRICES_MULT, stack, depth));
+        depth = 1; EXPECT_EQ(-4, prices_syntheticop(PRICES_DIV, stack, depth));
+        depth = 0; EXPECT_EQ(-5, prices_syntheticop(PRICES_INV, stack, depth));
+        depth = 2; EXPECT_EQ(-6, prices_syntheticop(PRICES_MDD, stack, depth));
+        depth = 2; EXPECT_EQ(-7, prices_syntheticop(PRICES_MMD, stack, depth));
+        depth = 2; EXPECT_EQ(-8, prices_syntheticop(PRICES_MMM, stack, depth));
+        depth = 2; EXPECT_EQ(-9, prices_syntheticop(PRICES_DDD, stack, depth));
+        depth = 2; EXPECT_EQ(-10, prices_syntheticop(KOMODO_MAXPRICES * 9, stack, depth));
+    }
+
+
+} /* namespace TestPrices */
@@ -118,6 +118,50 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+// Test that a snapshot does not see writes made after it was taken
+BOOST_AUTO_TEST_CASE(dbwrapper_snapshot)
+{
+    {
+        path ph = temp_directory_path() / unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false);
+
+        char key = 'j';
+        uint256 in = GetRandHash();
+        BOOST_CHECK(dbw.Write(key, in));
+
+        CDBSnapshot snapshot(dbw);
+
+        // Overwrite the key and add a second one after the snapshot
+        uint256 in_new = GetRandHash();
+        BOOST_CHECK(dbw.Write(key, in_new));
+        char key2 = 'k';
+        uint256 in2 = GetRandHash();
+        BOOST_CHECK(dbw.Write(key2, in2));
+
+        uint256 res;
+        BOOST_CHECK(snapshot.Read(key, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+        BOOST_CHECK(!snapshot.Exists(key2));
+        BOOST_CHECK(dbw.Read(key, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in_new.ToString());
+
+        boost::scoped_ptr<CDBIterator> it(snapshot.NewIterator());
+        it->Seek(key);
+        char key_res;
+        BOOST_CHECK(it->GetKey(key_res));
+        BOOST_CHECK(it->GetValue(res));
+        BOOST_CHECK_EQUAL(key_res, key);
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+        it->Next();
+        BOOST_CHECK_EQUAL(it->Valid(), false);
+
+        // Erasing is not visible through the snapshot either
+        BOOST_CHECK(dbw.Erase(key));
+        BOOST_CHECK(snapshot.Exists(key));
+        BOOST_CHECK(!dbw.Exists(key));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(iterator_ordering)
 {
     path ph = temp_directory_path() / unique_path();
@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "crypto/muhash.h"
+#include "streams.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 
@@ -47,4 +49,68 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+BOOST_AUTO_TEST_CASE(siphash)
+{
+    CSipHasher hasher(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x726fdb47dd0e0e31ull);
+    static const unsigned char t0[1] = {0};
+    hasher.Write(t0, 1);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x74f839c593dc67fdull);
+    static const unsigned char t1[7] = {1,2,3,4,5,6,7};
+    hasher.Write(t1, 7);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x93f5f5799a932462ull);
+    hasher.Write(0x0F0E0D0C0B0A0908ULL);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x3f2acc7f57c29bdbull);
+    static const unsigned char t2[2] = {16,17};
+    hasher.Write(t2, 2);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x4bc1b3f0968dd39cull);
+    static const unsigned char t3[9] = {18,19,20,21,22,23,24,25,26};
+    hasher.Write(t3, 9);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x2f2e6163076bcfadull);
+    static const unsigned char t4[5] = {27,28,29,30,31};
+    hasher.Write(t4, 5);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x7127512f72f27cceull);
+    hasher.Write(0x2726252423222120ULL);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x0e3ea96b5304a7d0ull);
+    hasher.Write(0x2F2E2D2C2B2A2928ULL);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0xe612a3cb9ecba951ull);
+
+    BOOST_CHECK_EQUAL(SipHashUint256(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, uint256S("1f1e1d1c1b1a191817161514131211100f0e0d0c0b0a09080706050403020100")), 0x7127512f72f27cceull);
+}
+
+BOOST_AUTO_TEST_CASE(muhash)
+{
+    static const unsigned char e0[1] = {0}, e1[1] = {1}, e2[1] = {2};
+
+    // The empty set hashes the number one
+    BOOST_CHECK(MuHash3072().Finalize() == uint256S("dd5ad2a105c2d29495f577245c357409002329b9f4d6182c0af3dc2f462555c8"));
+
+    MuHash3072 acc;
+    acc.Insert(e0, 1).Insert(e1, 1).Remove(e2, 1);
+    BOOST_CHECK(acc.Finalize() == uint256S("29296556564048df768f64c1ec7bf28fe168dc71a47fcad7e51683357752fbe9"));
+
+    // Independent of order, and removing an element undoes inserting it
+    MuHash3072 other(e2, 1);
+    other.Remove(e2, 1).Remove(e2, 1).Insert(e1, 1).Insert(e0, 1);
+    BOOST_CHECK(other.Finalize() == acc.Finalize());
+    other.Insert(e2, 1).Remove(e2, 1);
+    BOOST_CHECK(other.Finalize() == acc.Finalize());
+
+    // Sets combine with * and /
+    MuHash3072 a(e0, 1), b(e1, 1), c(e2, 1);
+    a *= b;
+    a /= c;
+    BOOST_CHECK(a.Finalize() == acc.Finalize());
+    a /= acc;
+    BOOST_CHECK(a.Finalize() == MuHash3072().Finalize());
+
+    // Serialization keeps numerator and denominator apart
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << acc;
+    BOOST_CHECK_EQUAL(ss.size(), 2 * Num3072::BYTE_SIZE);
+    MuHash3072 loaded;
+    ss >> loaded;
+    BOOST_CHECK(loaded.Finalize() == acc.Finalize());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -157,6 +157,125 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     BOOST_CHECK(it == pool.mapTx.get<1>().end());
 }
 
+BOOST_AUTO_TEST_CASE(MempoolCCIndexTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool(CFeeRate(0));
+    uint256 ref1 = GetRandHash(), ref2 = GetRandHash();
+
+    // evalcode, funcid and reference txid of each transaction's OP_RETURN
+    const uint8_t keys[][2] = { {0xec, 'D'}, {0xec, 'D'}, {0xec, 'F'}, {0xf2, 'D'} };
+    const uint256 refs[] = { ref1, ref2, ref1, ref1 };
+    std::vector<CMutableTransaction> txs(4);
+    for (int i = 0; i < 4; i++) {
+        std::vector<unsigned char> data(keys[i], keys[i] + 2);
+        data.insert(data.end(), refs[i].begin(), refs[i].end());
+        txs[i].vin.resize(1);
+        txs[i].vin[0].prevout = COutPoint(GetRandHash(), 0);
+        txs[i].vout.resize(2);
+        txs[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txs[i].vout[0].nValue = 10000LL;
+        txs[i].vout[1].scriptPubKey = CScript() << OP_RETURN << data;
+        pool.addUnchecked(txs[i].GetHash(), entry.FromTx(txs[i]));
+    }
+    // A plain transaction is not indexed
+    CMutableTransaction txPlain;
+    txPlain.vin.resize(1);
+    txPlain.vout.resize(1);
+    txPlain.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    pool.addUnchecked(txPlain.GetHash(), entry.FromTx(txPlain));
+
+    std::vector<uint256> txids;
+    pool.getCCIndex(txids, 0xec, 'D');
+    BOOST_CHECK_EQUAL(txids.size(), 2);
+    txids.clear();
+    pool.getCCIndex(txids, 0xec, 'D', ref2);
+    BOOST_CHECK_EQUAL(txids.size(), 1);
+    BOOST_CHECK(txids[0] == txs[1].GetHash());
+    txids.clear();
+    pool.getCCIndex(txids, 0xec, -1, ref1);
+    BOOST_CHECK_EQUAL(txids.size(), 2);
+    txids.clear();
+    pool.getCCIndex(txids, 0xec);
+    BOOST_CHECK_EQUAL(txids.size(), 3);
+
+    std::vector<CTransaction> matches;
+    pool.getCCTransactions(matches, 0xf2, 'D', ref1);
+    BOOST_CHECK_EQUAL(matches.size(), 1);
+    BOOST_CHECK(matches[0].GetHash() == txs[3].GetHash());
+
+    // Removed transactions leave the index
+    std::list<CTransaction> removed;
+    pool.remove(txs[0], removed, false);
+    txids.clear();
+    pool.getCCIndex(txids, 0xec, 'D');
+    BOOST_CHECK_EQUAL(txids.size(), 1);
+    pool.clear();
+    txids.clear();
+    pool.getCCIndex(txids, 0xec);
+    BOOST_CHECK_EQUAL(txids.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolKVIndexTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool(CFeeRate(0));
+
+    // 'K', key and value sizes, height, flags, key, value
+    const char *keys[] = { "kvtest_b", "kvtest_a", "kvtest_b", "other" };
+    std::vector<CMutableTransaction> txs(4);
+    for (int i = 0; i < 4; i++) {
+        std::string key(keys[i]), value("value");
+        std::vector<unsigned char> data(13);
+        data[0] = 'K';
+        data[1] = key.size();
+        data[3] = value.size();
+        data.insert(data.end(), key.begin(), key.end());
+        data.insert(data.end(), value.begin(), value.end());
+        txs[i].vin.resize(1);
+        txs[i].vin[0].prevout = COutPoint(GetRandHash(), 0);
+        txs[i].vout.resize(2);
+        // the KV output does not have to be the last one
+        txs[i].vout[0].scriptPubKey = CScript() << OP_RETURN << data;
+        txs[i].vout[0].nValue = 100000LL;
+        txs[i].vout[1].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        pool.addUnchecked(txs[i].GetHash(), entry.Time(100 - i).FromTx(txs[i]));
+    }
+    // 40 byte 'K' payloads are not KV updates
+    CMutableTransaction txOther;
+    txOther.vin.resize(1);
+    txOther.vout.resize(1);
+    txOther.vout[0].scriptPubKey = CScript() << OP_RETURN << std::vector<unsigned char>(40, 'K');
+    pool.addUnchecked(txOther.GetHash(), entry.FromTx(txOther));
+
+    // Oldest first
+    std::vector<CTransaction> matches;
+    pool.getKVTransactions(matches, "kvtest_b");
+    BOOST_CHECK_EQUAL(matches.size(), 2);
+    BOOST_CHECK(matches[0].GetHash() == txs[2].GetHash());
+    BOOST_CHECK(matches[1].GetHash() == txs[0].GetHash());
+
+    std::vector<std::string> found;
+    pool.getKVKeys(found, "kvtest_");
+    BOOST_CHECK_EQUAL(found.size(), 2);
+    BOOST_CHECK_EQUAL(found[0], "kvtest_a");
+    BOOST_CHECK_EQUAL(found[1], "kvtest_b");
+    found.clear();
+    pool.getKVKeys(found, "");
+    BOOST_CHECK_EQUAL(found.size(), 3);
+
+    // Removed transactions leave the index
+    std::list<CTransaction> removed;
+    pool.remove(txs[1], removed, false);
+    found.clear();
+    pool.getKVKeys(found, "kvtest_");
+    BOOST_CHECK_EQUAL(found.size(), 1);
+    pool.clear();
+    matches.clear();
+    pool.getKVTransactions(matches, "kvtest_b");
+    BOOST_CHECK_EQUAL(matches.size(), 0);
+}
+
 BOOST_AUTO_TEST_CASE(RemoveWithoutBranchId) {
     CTxMemPool pool(CFeeRate(0));
     TestMemPoolEntryHelper entry;
@@ -0,0 +1,145 @@
+// Copyright (c) 2019 The SuperNET developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TOKENINDEX_H
+#define BITCOIN_TOKENINDEX_H
+
+#include "uint256.h"
+#include "amount.h"
+#include "pubkey.h"
+#include "serialize.h"
+
+/**
+ * The token index (-tokenindex) keeps three tables in the block tree db:
+ *  - every confirmed token output that GetTokenBalance() would count, by outpoint.
+ *    Records stay after the output is spent so that a disconnect can restore it;
+ *  - the confirmed balance of each (tokenid, pubkey);
+ *  - the supply and number of holders of each token.
+ */
+struct CTokenOutputKey {
+    uint256 txid;
+    unsigned int outputIndex;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(outputIndex);
+    }
+
+    CTokenOutputKey(uint256 t, unsigned int i) {
+        txid = t;
+        outputIndex = i;
+    }
+
+    CTokenOutputKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        txid.SetNull();
+        outputIndex = 0;
+    }
+};
+
+struct CTokenOutputValue {
+    uint256 tokenid;
+    CPubKey pubkey;
+    CAmount satoshis;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(tokenid);
+        READWRITE(pubkey);
+        READWRITE(satoshis);
+    }
+
+    CTokenOutputValue(uint256 t, const CPubKey &pk, CAmount s) {
+        tokenid = t;
+        pubkey = pk;
+        satoshis = s;
+    }
+
+    CTokenOutputValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        tokenid.SetNull();
+        pubkey = CPubKey();
+        satoshis = 0;
+    }
+
+    bool IsNull() const {
+        return tokenid.IsNull();
+    }
+};
+
+struct CTokenBalanceKey {
+    uint256 tokenid;
+    CPubKey pubkey;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(tokenid);
+        READWRITE(pubkey);
+    }
+
+    CTokenBalanceKey(uint256 t, const CPubKey &pk) {
+        tokenid = t;
+        pubkey = pk;
+    }
+
+    CTokenBalanceKey() {
+        tokenid.SetNull();
+    }
+
+    friend bool operator<(const CTokenBalanceKey& a, const CTokenBalanceKey& b) {
+        if (a.tokenid == b.tokenid)
+            return a.pubkey < b.pubkey;
+        return a.tokenid < b.tokenid;
+    }
+};
+
+struct CTokenInfoValue {
+    CAmount supply;
+    unsigned int holders;
+    int blockHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(supply);
+        READWRITE(holders);
+        READWRITE(blockHeight);
+    }
+
+    CTokenInfoValue(CAmount s, unsigned int n, int h) {
+        supply = s;
+        holders = n;
+        blockHeight = h;
+    }
+
+    CTokenInfoValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        supply = 0;
+        holders = 0;
+        blockHeight = 0;
+    }
+
+    bool IsNull() const {
+        return blockHeight == 0;
+    }
+};
+
+#endif // BITCOIN_TOKENINDEX_H
@@ -7,6 +7,7 @@
 #include "main.h"
 #include "pubkey.h"
 #include "script/sign.h"
+#include "util.h"
 
 #include <boost/variant.hpp>
 #include <librustzcash.h>
@@ -25,6 +26,7 @@ TransactionBuilder::TransactionBuilder(
     int nHeight,
     CKeyStore* keystore) : consensusParams(consensusParams), nHeight(nHeight), keystore(keystore)
 {
+    nThreads = std::max(GetNumCores(), 1);
     mtx = CreateNewContextualCMutableTransaction(consensusParams, nHeight);
 }
 
@@ -131,10 +133,10 @@ boost::optional<CTransaction> TransactionBuilder::Build()
 
     // Valid change
     CAmount change = mtx.valueBalance - fee;
-    for (auto tIn : tIns) {
+    for (const auto& tIn : tIns) {
         change += tIn.value;
     }
-    for (auto tOut : mtx.vout) {
+    for (const auto& tOut : mtx.vout) {
         change -= tOut.nValue;
     }
     if (change < 0) {
@@ -167,22 +169,61 @@ boost::optional<CTransaction> TransactionBuilder::Build()
     // Sapling spends and outputs
     //
 
+    // Everything a description needs besides its proof is independent of the
+    // other descriptions: note commitments, nullifiers, the authentication
+    // paths of the spent notes' witnesses and the note encryption. It is
+    // prepared on nThreads threads.
+    struct SpendPrep {
+        boost::optional<uint256> cm;
+        boost::optional<uint256> nf;
+        std::vector<unsigned char> witness;
+    };
+    struct OutputPrep {
+        boost::optional<uint256> cm;
+        boost::optional<libzcash::SaplingNotePlaintextEncryptionResult> enc;
+    };
+    std::vector<SpendPrep> spendPreps(spends.size());
+    std::vector<OutputPrep> outputPreps(outputs.size());
+
+    ParallelFor(spends.size() + outputs.size(), nThreads, [&](size_t i) {
+        if (i < spends.size()) {
+            const auto& spend = spends[i];
+            auto& prep = spendPreps[i];
+            prep.cm = spend.note.cm();
+            prep.nf = spend.note.nullifier(
+                spend.expsk.full_viewing_key(), spend.witness.position());
+
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << spend.witness.path();
+            prep.witness.assign(ss.begin(), ss.end());
+        } else {
+            const auto& output = outputs[i - spends.size()];
+            auto& prep = outputPreps[i - spends.size()];
+            prep.cm = output.note.cm();
+            if (prep.cm) {
+                libzcash::SaplingNotePlaintext notePlaintext(output.note, output.memo);
+                prep.enc = notePlaintext.encrypt(output.note.pk_d);
+            }
+        }
+    });
+
     auto ctx = librustzcash_sapling_proving_ctx_init();
 
+    // The binding signature is made from the value commitments that the
+    // proofs accumulate in ctx, so they are all created in this one context.
+    // librustzcash cannot merge contexts, which keeps the spend and the
+    // output proofs alike on this thread.
+    size_t proofsDone = 0, proofsTotal = spends.size() + outputs.size();
+
     // Create Sapling SpendDescriptions
-    for (auto spend : spends) {
-        auto cm = spend.note.cm();
-        auto nf = spend.note.nullifier(
-            spend.expsk.full_viewing_key(), spend.witness.position());
-        if (!(cm && nf)) {
+    for (size_t i = 0; i < spends.size(); i++) {
+        const auto& spend = spends[i];
+        const auto& prep = spendPreps[i];
+        if (!(prep.cm && prep.nf)) {
             librustzcash_sapling_proving_ctx_free(ctx);
             return boost::none;
         }
 
-        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-        ss << spend.witness.path();
-        std::vector<unsigned char> witness(ss.begin(), ss.end());
-
         SpendDescription sdesc;
         if (!librustzcash_sapling_spend_proof(
                 ctx,
@@ -193,7 +234,7 @@ boost::optional<CTransaction> TransactionBuilder::Build()
                 spend.alpha.begin(),
                 spend.note.value(),
                 spend.anchor.begin(),
-                witness.data(),
+                prep.witness.data(),
                 sdesc.cv.begin(),
                 sdesc.rk.begin(),
                 sdesc.zkproof.data())) {
@@ -202,27 +243,22 @@ boost::optional<CTransaction> TransactionBuilder::Build()
         }
 
         sdesc.anchor = spend.anchor;
-        sdesc.nullifier = *nf;
+        sdesc.nullifier = *prep.nf;
         mtx.vShieldedSpend.push_back(sdesc);
+        if (proofProgress) {
+            proofProgress(++proofsDone, proofsTotal);
+        }
     }
 
     // Create Sapling OutputDescriptions
-    for (auto output : outputs) {
-        auto cm = output.note.cm();
-        if (!cm) {
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const auto& output = outputs[i];
+        auto& prep = outputPreps[i];
+        if (!(prep.cm && prep.enc)) {
             librustzcash_sapling_proving_ctx_free(ctx);
             return boost::none;
         }
-
-        libzcash::SaplingNotePlaintext notePlaintext(output.note, output.memo);
-
-        auto res = notePlaintext.encrypt(output.note.pk_d);
-        if (!res) {
-            librustzcash_sapling_proving_ctx_free(ctx);
-            return boost::none;
-        }
-        auto enc = res.get();
-        auto encryptor = enc.second;
+        auto& encryptor = prep.enc->second;
 
         OutputDescription odesc;
         if (!librustzcash_sapling_output_proof(
@@ -238,9 +274,9 @@ boost::optional<CTransaction> TransactionBuilder::Build()
             return boost::none;
         }
 
-        odesc.cm = *cm;
+        odesc.cm = *prep.cm;
         odesc.ephemeralKey = encryptor.get_epk();
-        odesc.encCiphertext = enc.first;
+        odesc.encCiphertext = prep.enc->first;
 
         libzcash::SaplingOutgoingPlaintext outPlaintext(output.note.pk_d, encryptor.get_esk());
         odesc.outCiphertext = outPlaintext.encrypt(
@@ -249,6 +285,9 @@ boost::optional<CTransaction> TransactionBuilder::Build()
             odesc.cm,
             encryptor);
         mtx.vShieldedOutput.push_back(odesc);
+        if (proofProgress) {
+            proofProgress(++proofsDone, proofsTotal);
+        }
     }
 
     // add op_return if there is one to add
@@ -18,6 +18,9 @@
 
 #include <boost/optional.hpp>
 
+#include <algorithm>
+#include <functional>
+
 struct SpendDescriptionInfo {
     libzcash::SaplingExpandedSpendingKey expsk;
     libzcash::SaplingNote note;
@@ -60,6 +63,7 @@ private:
     const CKeyStore* keystore;
     CMutableTransaction mtx;
     CAmount fee = 10000;
+    size_t nThreads = 1;
 
     std::vector<SpendDescriptionInfo> spends;
     std::vector<OutputDescriptionInfo> outputs;
@@ -68,6 +72,7 @@ private:
     boost::optional<std::pair<uint256, libzcash::SaplingPaymentAddress>> zChangeAddr;
     boost::optional<CTxDestination> tChangeAddr;
     boost::optional<CScript> opReturn;
+    std::function<void(size_t, size_t)> proofProgress;
 
     bool AddOpRetLast(CScript &s);
 
@@ -106,6 +111,14 @@ public:
 
     void SetLockTime(uint32_t time) { this->mtx.nLockTime = time; }
 
+    // Called by Build() with the number of Sapling proofs created so far and
+    // the total, after each proof.
+    void SetProofProgress(std::function<void(size_t, size_t)> progress) { proofProgress = progress; }
+
+    // Number of threads Build() prepares the Sapling descriptions on, one per
+    // core unless set.
+    void SetThreads(size_t threads) { nThreads = std::max(threads, (size_t)1); }
+
     boost::optional<CTransaction> Build();
 };
 
@@ -48,6 +48,10 @@ static const char DB_TIMESTAMPINDEX = 'S';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_UTXOSTATS = 'U';
+static const char DB_TOKENOUTPUT = 'o';
+static const char DB_TOKENBALANCE = 'k';
+static const char DB_TOKENINFO = 'K';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_SPROUT_ANCHOR = 'a';
@@ -65,7 +69,11 @@ CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(Get
 }
 
 
-bool CCoinsViewDB::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const {
+// The read side of the coin database is shared between CCoinsViewDB, which
+// reads the live database, and CCoinsViewDBSnapshot, which reads a CDBSnapshot.
+
+template<typename DB>
+static bool ReadSproutAnchorAt(const DB &db, const uint256 &rt, SproutMerkleTree &tree) {
     if (rt == SproutMerkleTree::empty_root()) {
         SproutMerkleTree new_tree;
         tree = new_tree;
@@ -77,7 +85,8 @@ bool CCoinsViewDB::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree)
     return read;
 }
 
-bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const {
+template<typename DB>
+static bool ReadSaplingAnchorAt(const DB &db, const uint256 &rt, SaplingMerkleTree &tree) {
     if (rt == SaplingMerkleTree::empty_root()) {
         SaplingMerkleTree new_tree;
         tree = new_tree;
@@ -89,7 +98,8 @@ bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree
     return read;
 }
 
-bool CCoinsViewDB::GetNullifier(const uint256 &nf, ShieldedType type) const {
+template<typename DB>
+static bool ReadNullifier(const DB &db, const uint256 &nf, ShieldedType type) {
     bool spent = false;
     char dbChar;
     switch (type) {
@@ -105,22 +115,16 @@ bool CCoinsViewDB::GetNullifier(const uint256 &nf, ShieldedType type) const {
     return db.Read(make_pair(dbChar, nf), spent);
 }
 
-bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
-    return db.Read(make_pair(DB_COINS, txid), coins);
-}
-
-bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
-    return db.Exists(make_pair(DB_COINS, txid));
-}
-
-uint256 CCoinsViewDB::GetBestBlock() const {
+template<typename DB>
+static uint256 ReadBestBlock(const DB &db) {
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
     return hashBestChain;
 }
 
-uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const {
+template<typename DB>
+static uint256 ReadBestAnchor(const DB &db, ShieldedType type) {
     uint256 hashBestAnchor;
 
     switch (type) {
@@ -139,6 +143,69 @@ uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const {
     return hashBestAnchor;
 }
 
+bool CCoinsViewDB::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const {
+    return ReadSproutAnchorAt(db, rt, tree);
+}
+
+bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const {
+    return ReadSaplingAnchorAt(db, rt, tree);
+}
+
+bool CCoinsViewDB::GetNullifier(const uint256 &nf, ShieldedType type) const {
+    return ReadNullifier(db, nf, type);
+}
+
+bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
+    return db.Read(make_pair(DB_COINS, txid), coins);
+}
+
+bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
+    return db.Exists(make_pair(DB_COINS, txid));
+}
+
+uint256 CCoinsViewDB::GetBestBlock() const {
+    return ReadBestBlock(db);
+}
+
+uint256 CCoinsViewDB::GetBestAnchor(ShieldedType type) const {
+    return ReadBestAnchor(db, type);
+}
+
+CCoinsView *CCoinsViewDB::CreateSnapshotView() const {
+    return new CCoinsViewDBSnapshot(db);
+}
+
+CCoinsViewDBSnapshot::CCoinsViewDBSnapshot(const CDBWrapper &db) : snapshot(db) {
+}
+
+bool CCoinsViewDBSnapshot::GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const {
+    return ReadSproutAnchorAt(snapshot, rt, tree);
+}
+
+bool CCoinsViewDBSnapshot::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const {
+    return ReadSaplingAnchorAt(snapshot, rt, tree);
+}
+
+bool CCoinsViewDBSnapshot::GetNullifier(const uint256 &nf, ShieldedType type) const {
+    return ReadNullifier(snapshot, nf, type);
+}
+
+bool CCoinsViewDBSnapshot::GetCoins(const uint256 &txid, CCoins &coins) const {
+    return snapshot.Read(make_pair(DB_COINS, txid), coins);
+}
+
+bool CCoinsViewDBSnapshot::HaveCoins(const uint256 &txid) const {
+    return snapshot.Exists(make_pair(DB_COINS, txid));
+}
+
+uint256 CCoinsViewDBSnapshot::GetBestBlock() const {
+    return ReadBestBlock(snapshot);
+}
+
+uint256 CCoinsViewDBSnapshot::GetBestAnchor(ShieldedType type) const {
+    return ReadBestAnchor(snapshot, type);
+}
+
 void BatchWriteNullifiers(CDBBatch& batch, CNullifiersMap& mapToUse, const char& dbChar)
 {
     for (CNullifiersMap::iterator it = mapToUse.begin(); it != mapToUse.end();) {
@@ -238,10 +305,13 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 }
 
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
-    /* It seems that there are no "const iterators" for LevelDB.  Since we
-       only need read operations on it, use a const-cast to get around
-       that restriction.  */
-    boost::scoped_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+    // Scan a snapshot so that the best block and the coins agree even if
+    // the database is flushed to while we iterate.
+    return CCoinsViewDBSnapshot(db).GetStats(stats);
+}
+
+bool CCoinsViewDBSnapshot::GetStats(CCoinsStats &stats) const {
+    boost::scoped_ptr<CDBIterator> pcursor(snapshot.NewIterator());
     pcursor->Seek(DB_COINS);
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
@@ -267,7 +337,7 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
                 stats.nSerializedSize += 32 + pcursor->GetValueSize();
                 ss << VARINT(0);
             } else {
-                return error("CCoinsViewDB::GetStats() : unable to read value");
+                return error("CCoinsViewDBSnapshot::GetStats() : unable to read value");
             }
         } else {
             break;
@@ -283,6 +353,40 @@ bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
     return true;
 }
 
+bool CCoinsViewDB::GetUtxoStats(CUtxoStats &stats) const {
+    return CCoinsViewDBSnapshot(db).GetUtxoStats(stats);
+}
+
+bool CCoinsViewDBSnapshot::GetUtxoStats(CUtxoStats &stats) const {
+    boost::scoped_ptr<CDBIterator> pcursor(snapshot.NewIterator());
+    pcursor->Seek(DB_COINS);
+
+    stats.hashBlock = GetBestBlock();
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        CCoins coins;
+        if (pcursor->GetKey(key) && key.first == DB_COINS) {
+            if (pcursor->GetValue(coins)) {
+                stats.AddCoins(key.second, coins);
+            } else {
+                return error("CCoinsViewDBSnapshot::GetUtxoStats() : unable to read value");
+            }
+        } else {
+            break;
+        }
+        pcursor->Next();
+    }
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(stats.hashBlock);
+        if (mi == mapBlockIndex.end() || mi->second == NULL)
+            return false;
+        stats.nHeight = mi->second->GetHeight();
+    }
+    return true;
+}
+
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
@@ -660,6 +764,78 @@ bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &lt
     return true;
 }
 
+bool CBlockTreeDB::ReadUtxoStats(const uint256 &hash, CUtxoStats &stats) {
+    return Read(std::make_pair(DB_UTXOSTATS, hash), stats);
+}
+
+bool CBlockTreeDB::WriteUtxoStats(const CUtxoStats &stats) {
+    return Write(std::make_pair(DB_UTXOSTATS, stats.hashBlock), stats);
+}
+
+bool CBlockTreeDB::EraseUtxoStats(const uint256 &hash) {
+    return Erase(std::make_pair(DB_UTXOSTATS, hash));
+}
+
+bool CBlockTreeDB::ReadTokenOutput(const CTokenOutputKey &key, CTokenOutputValue &value) {
+    return Read(std::make_pair(DB_TOKENOUTPUT, key), value);
+}
+
+bool CBlockTreeDB::ReadTokenBalance(const CTokenBalanceKey &key, CAmount &balance) {
+    return Read(std::make_pair(DB_TOKENBALANCE, key), balance);
+}
+
+bool CBlockTreeDB::ReadTokenInfo(const uint256 &tokenid, CTokenInfoValue &info) {
+    return Read(std::make_pair(DB_TOKENINFO, tokenid), info);
+}
+
+bool CBlockTreeDB::ReadTokenList(std::vector<uint256> &tokenids) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_TOKENINFO, uint256()));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        if (pcursor->GetKey(key) && key.first == DB_TOKENINFO) {
+            tokenids.push_back(key.second);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::UpdateTokenIndex(const std::vector<std::pair<CTokenOutputKey, CTokenOutputValue> > &outputs,
+                                    const std::vector<std::pair<CTokenBalanceKey, CAmount> > &balances,
+                                    const std::vector<std::pair<uint256, CTokenInfoValue> > &infos) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CTokenOutputKey, CTokenOutputValue> >::const_iterator it=outputs.begin(); it!=outputs.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_TOKENOUTPUT, it->first));
+        } else {
+            batch.Write(make_pair(DB_TOKENOUTPUT, it->first), it->second);
+        }
+    }
+    for (std::vector<std::pair<CTokenBalanceKey, CAmount> >::const_iterator it=balances.begin(); it!=balances.end(); it++) {
+        if (it->second == 0) {
+            batch.Erase(make_pair(DB_TOKENBALANCE, it->first));
+        } else {
+            batch.Write(make_pair(DB_TOKENBALANCE, it->first), it->second);
+        }
+    }
+    for (std::vector<std::pair<uint256, CTokenInfoValue> >::const_iterator it=infos.begin(); it!=infos.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_TOKENINFO, it->first));
+        } else {
+            batch.Write(make_pair(DB_TOKENINFO, it->first), it->second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
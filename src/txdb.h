@@ -38,6 +38,10 @@ struct CAddressUnspentValue;
 struct CAddressIndexKey;
 struct CAddressIndexIteratorKey;
 struct CAddressIndexIteratorHeightKey;
+struct CTokenOutputKey;
+struct CTokenOutputValue;
+struct CTokenBalanceKey;
+struct CTokenInfoValue;
 struct CTimestampIndexKey;
 struct CTimestampIndexIteratorKey;
 struct CTimestampBlockIndexKey;
@@ -78,6 +82,31 @@ public:
                     CNullifiersMap &mapSproutNullifiers,
                     CNullifiersMap &mapSaplingNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    bool GetUtxoStats(CUtxoStats &stats) const;
+    CCoinsView *CreateSnapshotView() const;
+};
+
+/**
+ * Read-only CCoinsView over a snapshot of the coin database, see
+ * CCoinsView::CreateSnapshotView. It needs no lock to be read from, while
+ * the chainstate keeps being updated underneath it.
+ */
+class CCoinsViewDBSnapshot : public CCoinsView
+{
+protected:
+    CDBSnapshot snapshot;
+public:
+    CCoinsViewDBSnapshot(const CDBWrapper &db);
+
+    bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
+    bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
+    bool GetNullifier(const uint256 &nf, ShieldedType type) const;
+    bool GetCoins(const uint256 &txid, CCoins &coins) const;
+    bool HaveCoins(const uint256 &txid) const;
+    uint256 GetBestBlock() const;
+    uint256 GetBestAnchor(ShieldedType type) const;
+    bool GetStats(CCoinsStats &stats) const;
+    bool GetUtxoStats(CUtxoStats &stats) const;
 };
 
 /** Access to the block database (blocks/index/) */
@@ -111,6 +140,16 @@ public:
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
+    bool ReadUtxoStats(const uint256 &hash, CUtxoStats &stats);
+    bool WriteUtxoStats(const CUtxoStats &stats);
+    bool EraseUtxoStats(const uint256 &hash);
+    bool ReadTokenOutput(const CTokenOutputKey &key, CTokenOutputValue &value);
+    bool ReadTokenBalance(const CTokenBalanceKey &key, CAmount &balance);
+    bool ReadTokenInfo(const uint256 &tokenid, CTokenInfoValue &info);
+    bool ReadTokenList(std::vector<uint256> &tokenids);
+    bool UpdateTokenIndex(const std::vector<std::pair<CTokenOutputKey, CTokenOutputValue> > &outputs,
+                          const std::vector<std::pair<CTokenBalanceKey, CAmount> > &balances,
+                          const std::vector<std::pair<uint256, CTokenInfoValue> > &infos);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts();
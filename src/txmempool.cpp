@@ -137,6 +137,8 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     for (const SpendDescription &spendDescription : tx.vShieldedSpend) {
         mapSaplingNullifiers[spendDescription.nullifier] = &tx;
     }
+    addCCIndex(tx);
+    addKVIndex(tx);
     nTransactionsUpdated++;
     totalTxSize += entry.GetTxSize();
     cachedInnerUsage += entry.DynamicMemoryUsage();
@@ -145,6 +147,151 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     return true;
 }
 
+/** Parse the CC index key of tx from the OP_RETURN in its last output. */
+static bool GetCCIndexKey(const CTransaction& tx, uint8_t& evalcode, uint8_t& funcid, uint256& reftxid)
+{
+    if (tx.vout.empty())
+        return false;
+    const CScript& script = tx.vout.back().scriptPubKey;
+    CScript::const_iterator pc = script.begin();
+    opcodetype opcode;
+    std::vector<unsigned char> data;
+    if (!script.GetOp(pc, opcode) || opcode != OP_RETURN)
+        return false;
+    if (!script.GetOp(pc, opcode, data) || data.size() < 2)
+        return false;
+    evalcode = data[0];
+    funcid = data[1];
+    if (data.size() >= 2 + reftxid.size())
+        memcpy(reftxid.begin(), &data[2], reftxid.size());
+    else
+        reftxid.SetNull();
+    return true;
+}
+
+void CTxMemPool::addCCIndex(const CTransaction& tx)
+{
+    uint8_t evalcode, funcid;
+    uint256 reftxid;
+    if (!GetCCIndexKey(tx, evalcode, funcid, reftxid))
+        return;
+    CMempoolCCKey key(evalcode, funcid, reftxid, tx.GetHash());
+    setCCIndex.insert(key);
+    mapCCInserted.insert(std::make_pair(key.txhash, key));
+}
+
+void CTxMemPool::removeCCIndex(const uint256& txhash)
+{
+    std::map<uint256, CMempoolCCKey>::iterator it = mapCCInserted.find(txhash);
+    if (it != mapCCInserted.end()) {
+        setCCIndex.erase(it->second);
+        mapCCInserted.erase(it);
+    }
+}
+
+void CTxMemPool::getCCIndex(std::vector<uint256>& txids, uint8_t evalcode, int funcid, const uint256& reftxid) const
+{
+    LOCK(cs);
+    std::set<CMempoolCCKey>::const_iterator it = setCCIndex.lower_bound(
+        CMempoolCCKey(evalcode, funcid < 0 ? 0 : funcid, funcid < 0 ? uint256() : reftxid, uint256()));
+    for (; it != setCCIndex.end() && it->evalcode == evalcode; it++) {
+        if (funcid >= 0 && it->funcid != funcid)
+            break;
+        if (!reftxid.IsNull() && it->reftxid != reftxid) {
+            // within one funcid the keys are sorted by reftxid
+            if (funcid >= 0)
+                break;
+            continue;
+        }
+        txids.push_back(it->txhash);
+    }
+}
+
+void CTxMemPool::getCCTransactions(std::vector<CTransaction>& txs, uint8_t evalcode, int funcid, const uint256& reftxid) const
+{
+    LOCK(cs);
+    std::vector<uint256> txids;
+    getCCIndex(txids, evalcode, funcid, reftxid);
+    txs.reserve(txs.size() + txids.size());
+    for (const uint256& txid : txids) {
+        indexed_transaction_set::const_iterator i = mapTx.find(txid);
+        if (i != mapTx.end())
+            txs.push_back(i->GetTx());
+    }
+}
+
+/**
+ * Parse the key of a KV update from an OP_RETURN output: 'K', key and value
+ * sizes, height and flags, then the key. 40 byte 'K' payloads are not KV
+ * updates, as in komodo_opreturn.
+ */
+static bool GetKVIndexKey(const CScript& script, std::string& key)
+{
+    CScript::const_iterator pc = script.begin();
+    opcodetype opcode;
+    std::vector<unsigned char> data;
+    if (!script.GetOp(pc, opcode) || opcode != OP_RETURN)
+        return false;
+    if (!script.GetOp(pc, opcode, data) || data.size() < 13 || data[0] != 'K' || data.size() == 40)
+        return false;
+    size_t keylen = data[1] | (data[2] << 8);
+    if (13 + keylen > data.size())
+        return false;
+    key.assign((const char *)&data[13], keylen);
+    return true;
+}
+
+void CTxMemPool::addKVIndex(const CTransaction& tx)
+{
+    std::vector<std::string> keys;
+    std::string key;
+    for (const CTxOut& txout : tx.vout) {
+        if (GetKVIndexKey(txout.scriptPubKey, key)) {
+            setKVIndex.insert(std::make_pair(key, tx.GetHash()));
+            keys.push_back(key);
+        }
+    }
+    if (!keys.empty())
+        mapKVInserted.insert(std::make_pair(tx.GetHash(), keys));
+}
+
+void CTxMemPool::removeKVIndex(const uint256& txhash)
+{
+    std::map<uint256, std::vector<std::string> >::iterator it = mapKVInserted.find(txhash);
+    if (it != mapKVInserted.end()) {
+        for (const std::string& key : it->second)
+            setKVIndex.erase(std::make_pair(key, txhash));
+        mapKVInserted.erase(it);
+    }
+}
+
+void CTxMemPool::getKVTransactions(std::vector<CTransaction>& txs, const std::string& key) const
+{
+    LOCK(cs);
+    std::vector<std::pair<int64_t, const CTransaction*> > found;
+    std::set<std::pair<std::string, uint256> >::const_iterator it = setKVIndex.lower_bound(std::make_pair(key, uint256()));
+    for (; it != setKVIndex.end() && it->first == key; it++) {
+        indexed_transaction_set::const_iterator i = mapTx.find(it->second);
+        if (i != mapTx.end())
+            found.push_back(std::make_pair(i->GetTime(), &i->GetTx()));
+    }
+    std::stable_sort(found.begin(), found.end(),
+        [](const std::pair<int64_t, const CTransaction*>& a, const std::pair<int64_t, const CTransaction*>& b) { return a.first < b.first; });
+    txs.reserve(txs.size() + found.size());
+    for (const std::pair<int64_t, const CTransaction*>& f : found)
+        txs.push_back(*f.second);
+}
+
+void CTxMemPool::getKVKeys(std::vector<std::string>& keys, const std::string& prefix) const
+{
+    LOCK(cs);
+    std::set<std::pair<std::string, uint256> >::const_iterator it = setKVIndex.lower_bound(std::make_pair(prefix, uint256()));
+    for (; it != setKVIndex.end() && it->first.compare(0, prefix.size(), prefix) == 0; it++) {
+        if (keys.empty() || keys.back() != it->first)
+            keys.push_back(it->first);
+    }
+}
+
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
     LOCK(cs);
@@ -387,6 +534,8 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
             minerPolicyEstimator->removeTx(hash);
             removeAddressIndex(hash);
             removeSpentIndex(hash);
+            removeCCIndex(hash);
+            removeKVIndex(hash);
         }
     }
 }
@@ -591,6 +740,10 @@ void CTxMemPool::clear()
     LOCK(cs);
     mapTx.clear();
     mapNextTx.clear();
+    setCCIndex.clear();
+    mapCCInserted.clear();
+    setKVIndex.clear();
+    mapKVInserted.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     ++nTransactionsUpdated;
@@ -752,6 +905,25 @@ bool CTxMemPool::lookup(uint256 hash, CTransaction& result) const
     return true;
 }
 
+bool CTxMemPool::getSpender(const COutPoint& outpoint, uint256& spenderHash, int32_t& spenderVin) const
+{
+    LOCK(cs);
+    std::map<COutPoint, CInPoint>::const_iterator it = mapNextTx.find(outpoint);
+    if (it == mapNextTx.end()) return false;
+    spenderHash = it->second.ptx->GetHash();
+    spenderVin = it->second.n;
+    return true;
+}
+
+void CTxMemPool::getSpent(const std::vector<COutPoint>& outpoints, std::vector<bool>& vSpent) const
+{
+    vSpent.assign(outpoints.size(), false);
+    LOCK(cs);
+    if (mapNextTx.empty()) return;
+    for (size_t i = 0; i < outpoints.size(); i++)
+        vSpent[i] = mapNextTx.count(outpoints[i]) != 0;
+}
+
 CFeeRate CTxMemPool::estimateFee(int nBlocks) const
 {
     LOCK(cs);
@@ -915,5 +1087,5 @@ bool CCoinsViewMemPool::HaveCoins(const uint256 &txid) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 6 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 6 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 6 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(setCCIndex) + memusage::DynamicUsage(mapCCInserted) + memusage::DynamicUsage(setKVIndex) + memusage::DynamicUsage(mapKVInserted) + cachedInnerUsage;
 }
@@ -22,6 +22,7 @@
 #define BITCOIN_TXMEMPOOL_H
 
 #include <list>
+#include <set>
 
 #include "addressindex.h"
 #include "spentindex.h"
@@ -128,6 +129,33 @@ public:
     size_t DynamicMemoryUsage() const { return 0; }
 };
 
+/**
+ * Key of the mempool CC index: the evalcode and funcid that start the
+ * OP_RETURN data of a transaction's last output, and the 32 bytes following
+ * them, which most CC modules use for the txid the transaction refers to
+ * (oracle, token, channel, ...).
+ */
+struct CMempoolCCKey
+{
+    uint8_t evalcode;
+    uint8_t funcid;
+    uint256 reftxid;
+    uint256 txhash;
+
+    CMempoolCCKey(uint8_t evalcodeIn, uint8_t funcidIn, const uint256& reftxidIn, const uint256& txhashIn) :
+        evalcode(evalcodeIn), funcid(funcidIn), reftxid(reftxidIn), txhash(txhashIn) {}
+
+    bool operator<(const CMempoolCCKey& b) const {
+        if (evalcode != b.evalcode)
+            return evalcode < b.evalcode;
+        if (funcid != b.funcid)
+            return funcid < b.funcid;
+        if (reftxid != b.reftxid)
+            return reftxid < b.reftxid;
+        return txhash < b.txhash;
+    }
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain
  * transactions that may be included in the next block.
@@ -187,6 +215,18 @@ private:
     typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
+    std::set<CMempoolCCKey> setCCIndex;
+    std::map<uint256, CMempoolCCKey> mapCCInserted;
+
+    void addCCIndex(const CTransaction& tx);
+    void removeCCIndex(const uint256& txhash);
+
+    std::set<std::pair<std::string, uint256> > setKVIndex;
+    std::map<uint256, std::vector<std::string> > mapKVInserted;
+
+    void addKVIndex(const CTransaction& tx);
+    void removeKVIndex(const uint256& txhash);
+
 public:
     std::map<COutPoint, CInPoint> mapNextTx;
     std::map<uint256, std::pair<double, CAmount> > mapDeltas;
@@ -261,6 +301,28 @@ public:
 
     bool lookup(uint256 hash, CTransaction& result) const;
 
+    /** Find the pool transaction and input index spending outpoint, if any. */
+    bool getSpender(const COutPoint& outpoint, uint256& spenderHash, int32_t& spenderVin) const;
+    /** Look up which of outpoints are spent by pool transactions under a single lock. */
+    void getSpent(const std::vector<COutPoint>& outpoints, std::vector<bool>& vSpent) const;
+
+    /**
+     * Find the pool transactions whose OP_RETURN starts with evalcode and
+     * funcid (any funcid if negative) and, if reftxid is not null, refers
+     * to reftxid, without walking the whole pool. getCCTransactions copies
+     * only the matching transactions.
+     */
+    void getCCIndex(std::vector<uint256>& txids, uint8_t evalcode, int funcid = -1, const uint256& reftxid = uint256()) const;
+    void getCCTransactions(std::vector<CTransaction>& txs, uint8_t evalcode, int funcid = -1, const uint256& reftxid = uint256()) const;
+
+    /**
+     * Find the pool transactions with a KV update ('K' OP_RETURN, see
+     * komodo_kvupdate) of key, oldest first, and the keys starting with
+     * prefix that have one.
+     */
+    void getKVTransactions(std::vector<CTransaction>& txs, const std::string& key) const;
+    void getKVKeys(std::vector<std::string>& keys, const std::string& prefix) const;
+
     /** Estimate fee rate needed to get into the next nBlocks */
     CFeeRate estimateFee(int nBlocks) const;
 
@@ -56,6 +56,8 @@
 
 #include <algorithm>
 #include <fcntl.h>
+#include <mutex>
+#include <thread>
 #include <sys/resource.h>
 #include <sys/stat.h>
 
@@ -1040,3 +1042,35 @@ int GetNumCores()
     return boost::thread::physical_concurrency();
 }
 
+void ParallelFor(size_t n, size_t nThreads, const std::function<void(size_t)>& f)
+{
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < n) {
+            try {
+                f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(n, nThreads); i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
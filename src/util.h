@@ -35,6 +35,7 @@
 
 #include <atomic>
 #include <exception>
+#include <functional>
 #include <map>
 #include <stdint.h>
 #include <string>
@@ -256,6 +257,12 @@ std::string HelpMessageOpt(const std::string& option, const std::string& message
  */
 int GetNumCores();
 
+/**
+ * Run f(0) .. f(n - 1) on up to nThreads threads, including the calling one.
+ * The first exception thrown by f is rethrown once all threads have finished.
+ */
+void ParallelFor(size_t n, size_t nThreads, const std::function<void(size_t)>& f);
+
 void SetThreadPriority(int nPriority);
 void RenameThread(const char* name);
 
@@ -24,7 +24,7 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 170009;
+static const int PROTOCOL_VERSION = 170010;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -49,4 +49,7 @@ static const int MEMPOOL_GD_VERSION = 60002;
 //! "filter*" commands are disabled without NODE_BLOOM after and including this version
 static const int NO_BLOOM_VERSION = 170004;
 
+//! short-id-based block download (sendcmpct, cmpctblock, getblocktxn, blocktxn) starts with this version
+static const int SHORT_IDS_BLOCKS_VERSION = 170010;
+
 #endif // BITCOIN_VERSION_H
@@ -518,6 +518,7 @@ bool AsyncRPCOperation_sendmany::main_impl() {
         }
 
         // Build the transaction
+        builder_.SetProofProgress([this](size_t done, size_t total) { set_proof_progress(done, total); });
         auto maybe_tx = builder_.Build();
         if (!maybe_tx) {
             throw JSONRPCError(RPC_WALLET_ERROR, "Failed to build transaction.");
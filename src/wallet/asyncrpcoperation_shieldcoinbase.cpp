@@ -300,6 +300,8 @@ bool ShieldToAddress::operator()(const libzcash::SaplingPaymentAddress &zaddr) c
     m_op->builder_.SendChangeTo(zaddr, ovk);
 
     // Build the transaction
+    AsyncRPCOperation_shieldcoinbase* op = m_op;
+    m_op->builder_.SetProofProgress([op](size_t done, size_t total) { op->set_proof_progress(done, total); });
     auto maybe_tx = m_op->builder_.Build();
     if (!maybe_tx) {
         throw JSONRPCError(RPC_WALLET_ERROR, "Failed to build transaction.");
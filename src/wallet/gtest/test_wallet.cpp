@@ -1545,6 +1545,92 @@ TEST(WalletTests, CachedWitnessesCleanIndex) {
     }
 }
 
+TEST(WalletTests, CachedWitnessesDropSpentBeyondCache) {
+    TestWallet wallet;
+    SproutMerkleTree sproutTree;
+    SaplingMerkleTree saplingTree;
+
+    auto sk = libzcash::SproutSpendingKey::random();
+    wallet.AddSproutSpendingKey(sk);
+
+    // First block, with a note that gets spent and one that does not
+    CBlock block1;
+    std::vector<JSOutPoint> sproutNotes;
+    std::vector<libzcash::SproutNote> notes;
+    for (int i = 0; i < 2; i++) {
+        auto wtx = GetValidReceive(sk, 50, true, 4);
+        auto note = GetNote(sk, wtx, 0, 1);
+
+        mapSproutNoteData_t noteData;
+        JSOutPoint jsoutpt {wtx.GetHash(), 0, 1};
+        SproutNoteData nd {sk.address(), note.nullifier(sk)};
+        noteData[jsoutpt] = nd;
+        wtx.SetSproutNoteData(noteData);
+        wallet.AddToWallet(wtx, true, NULL);
+
+        block1.vtx.push_back(wtx);
+        sproutNotes.push_back(jsoutpt);
+        notes.push_back(note);
+    }
+    CBlockIndex index1(block1);
+    index1.SetHeight(1);
+    wallet.IncrementNoteWitnesses(&index1, &block1, sproutTree, saplingTree);
+
+    // Fake-mine a spend of the first note, followed by WITNESS_CACHE_SIZE blocks
+    auto spend = GetValidSpend(sk, notes[0], 5);
+    CBlock spendBlock;
+    spendBlock.vtx.push_back(spend);
+    spendBlock.hashMerkleRoot = spendBlock.BuildMerkleTree();
+    auto spendBlockHash = spendBlock.GetHash();
+    CBlockIndex spendIndex {spendBlock};
+    mapBlockIndex.insert(std::make_pair(spendBlockHash, &spendIndex));
+    std::vector<CBlockIndex> chain(WITNESS_CACHE_SIZE);
+    for (size_t i = 0; i < chain.size(); i++) {
+        chain[i].pprev = i == 0 ? &spendIndex : &chain[i - 1];
+        chain[i].SetHeight(i + 1);
+    }
+    spend.SetMerkleBranch(spendBlock);
+    wallet.AddToWallet(spend, true, NULL);
+
+    std::vector<boost::optional<SproutWitness>> sproutWitnesses;
+    std::vector<boost::optional<SaplingWitness>> saplingWitnesses;
+    std::vector<SaplingOutPoint> saplingNotes;
+
+    // A spend WITNESS_CACHE_SIZE deep can still be undone, the witness is kept
+    chainActive.SetTip(&chain[chain.size() - 2]);
+    EXPECT_EQ((int) WITNESS_CACHE_SIZE, spend.GetDepthInMainChain());
+    CBlock block2;
+    CBlockIndex index2(block2);
+    index2.SetHeight(2);
+    wallet.IncrementNoteWitnesses(&index2, &block2, sproutTree, saplingTree);
+    GetWitnessesAndAnchors(wallet, sproutNotes, saplingNotes, sproutWitnesses, saplingWitnesses);
+    EXPECT_TRUE((bool) sproutWitnesses[0]);
+    EXPECT_TRUE((bool) sproutWitnesses[1]);
+
+    // One block deeper the spent note loses its witnesses, the other keeps them
+    chainActive.SetTip(&chain.back());
+    EXPECT_EQ((int) WITNESS_CACHE_SIZE + 1, spend.GetDepthInMainChain());
+    CBlock block3;
+    CBlockIndex index3(block3);
+    index3.SetHeight(3);
+    wallet.IncrementNoteWitnesses(&index3, &block3, sproutTree, saplingTree);
+    GetWitnessesAndAnchors(wallet, sproutNotes, saplingNotes, sproutWitnesses, saplingWitnesses);
+    EXPECT_FALSE((bool) sproutWitnesses[0]);
+    EXPECT_TRUE((bool) sproutWitnesses[1]);
+
+    // Its height is still tracked, so blocks can be disconnected and connected again
+    wallet.DecrementNoteWitnesses(&index3);
+    wallet.IncrementNoteWitnesses(&index3, &block3, sproutTree, saplingTree);
+    EXPECT_FALSE(wallet.needsRescan);
+    GetWitnessesAndAnchors(wallet, sproutNotes, saplingNotes, sproutWitnesses, saplingWitnesses);
+    EXPECT_FALSE((bool) sproutWitnesses[0]);
+    EXPECT_TRUE((bool) sproutWitnesses[1]);
+
+    // Tear down
+    chainActive.SetTip(NULL);
+    mapBlockIndex.erase(spendBlockHash);
+}
+
 TEST(WalletTests, ClearNoteWitnessCache) {
     TestWallet wallet;
 
@@ -583,7 +583,7 @@ int32_t komodo_is_issuer();
 int32_t iguana_rwnum(int32_t rwflag,uint8_t *serialized,int32_t len,void *endianedp);
 int32_t komodo_isrealtime(int32_t *kmdheightp);
 int32_t pax_fiatstatus(uint64_t *available,uint64_t *deposited,uint64_t *issued,uint64_t *withdrawn,uint64_t *approved,uint64_t *redeemed,char *base);
-int32_t komodo_kvsearch(uint256 *refpubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen);
+int32_t komodo_kvsearch_mempool(uint256 *refpubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen);
 int32_t komodo_kvcmp(uint8_t *refvalue,uint16_t refvaluesize,uint8_t *value,uint16_t valuesize);
 uint64_t komodo_kvfee(uint32_t flags,int32_t opretlen,int32_t keylen);
 uint256 komodo_kvsig(uint8_t *buf,int32_t len,uint256 privkey);
@@ -657,7 +657,8 @@ UniValue kvupdate(const UniValue& params, bool fHelp, const CPubKey& mypk)
             valuesize = (int32_t)strlen(params[1].get_str().c_str());
         }
         memcpy(keyvalue,key,keylen);
-        if ( (refvaluesize= komodo_kvsearch(&refpubkey,chainActive.LastTip()->GetHeight(),&tmpflags,&height,&keyvalue[keylen],key,keylen)) >= 0 )
+        // sign over the value a pending update leaves, which is what the key holds when this one is mined after it
+        if ( (refvaluesize= komodo_kvsearch_mempool(&refpubkey,chainActive.LastTip()->GetHeight(),&tmpflags,&height,&keyvalue[keylen],key,keylen)) >= 0 )
         {
             if ( (tmpflags & KOMODO_KVPROTECTED) != 0 )
             {
@@ -3379,6 +3380,17 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
         } else if (benchmarktype == "incnotewitnesses") {
             int nTxs = params[2].get_int();
             sample_times.push_back(benchmark_increment_note_witnesses(nTxs));
+        } else if (benchmarktype == "incsaplingnotewitnesses") {
+            // Number of wallet transactions, and of Sapling outputs in the block
+            int nTxs = 100000;
+            int nOutputs = 20;
+            if (params.size() >= 3) {
+                nTxs = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                nOutputs = params[3].get_int();
+            }
+            sample_times.push_back(benchmark_increment_sapling_note_witnesses(nTxs, nOutputs));
         } else if (benchmarktype == "connectblockslow") {
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
@@ -3401,10 +3413,29 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
             sample_times.push_back(benchmark_create_sapling_spend());
         } else if (benchmarktype == "createsaplingoutput") {
             sample_times.push_back(benchmark_create_sapling_output());
+        } else if (benchmarktype == "createsaplingtransaction") {
+            // Number of notes spent by the transaction
+            int nSpends = 10;
+            if (params.size() >= 3) {
+                nSpends = params[2].get_int();
+            }
+            // Number of threads preparing the descriptions
+            int nThreads = 1;
+            if (params.size() >= 4) {
+                nThreads = params[3].get_int();
+            }
+            sample_times.push_back(benchmark_create_sapling_transaction(nSpends, nThreads));
         } else if (benchmarktype == "verifysaplingspend") {
             sample_times.push_back(benchmark_verify_sapling_spend());
         } else if (benchmarktype == "verifysaplingoutput") {
             sample_times.push_back(benchmark_verify_sapling_output());
+        } else if (benchmarktype == "spentinmempool" || benchmarktype == "spentinmempoolscan") {
+            // Number of transactions in the simulated mempool
+            int nTxs = 20000;
+            if (params.size() >= 3) {
+                nTxs = params[2].get_int();
+            }
+            sample_times.push_back(benchmark_mempool_spent_lookup(nTxs, benchmarktype == "spentinmempoolscan"));
         } else {
             throw JSONRPCError(RPC_TYPE_ERROR, "Invalid benchmarktype");
         }
@@ -7120,15 +7151,21 @@ UniValue oraclessample(const UniValue& params, bool fHelp, const CPubKey& mypk)
 
 UniValue oraclessamples(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
-    UniValue result(UniValue::VOBJ); uint256 txid; int32_t num; char *batonaddr;
-    if ( fHelp || params.size() != 3 )
-        throw runtime_error("oraclessamples oracletxid batonaddress num\n");
+    UniValue result(UniValue::VOBJ); uint256 txid; int32_t num,startheight=0,endheight=0; char *batonaddr;
+    if ( fHelp || params.size() < 3 || params.size() > 5 )
+        throw runtime_error("oraclessamples oracletxid batonaddress num [startheight] [endheight]\n");
     if ( ensure_CCrequirements(EVAL_ORACLES) < 0 )
         throw runtime_error(CC_REQUIREMENTS_MSG);
     txid = Parseuint256((char *)params[0].get_str().c_str());
     batonaddr = (char *)params[1].get_str().c_str();
     num = atoi((char *)params[2].get_str().c_str());
-    return(OracleDataSamples(txid,batonaddr,num));
+    if ( params.size() > 3 )
+        startheight = atoi((char *)params[3].get_str().c_str());
+    if ( params.size() > 4 )
+        endheight = atoi((char *)params[4].get_str().c_str());
+    if ( startheight < 0 || endheight < 0 || (endheight > 0 && endheight < startheight) )
+        throw runtime_error("invalid height range\n");
+    return(OracleDataSamples(txid,batonaddr,num,startheight,endheight));
 }
 
 UniValue oraclesdata(const UniValue& params, bool fHelp, const CPubKey& mypk)
@@ -7583,21 +7620,28 @@ UniValue tokeninfo(const UniValue& params, bool fHelp, const CPubKey& mypk)
 UniValue tokenorders(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     uint256 tokenid;
-    if ( fHelp || params.size() > 1 )
-        throw runtime_error("tokenorders [tokenid]\n"
-                            "returns token orders for the tokenid or all available token orders if tokenid is not set\n"
+    int32_t count = 0, skip = 0;
+    if ( fHelp || params.size() > 3 )
+        throw runtime_error("tokenorders [tokenid] [count] [skip]\n"
+                            "returns token orders for the tokenid or all available token orders if tokenid is not set or is empty\n"
+                            "orders are sorted by tokenid, then bids from the highest price and asks from the lowest price\n"
+                            "if count is set returns no more than count orders after skipping the first skip orders\n"
                             "(this rpc supports only fungible tokens)\n" "\n");
     if (ensure_CCrequirements(EVAL_ASSETS) < 0 || ensure_CCrequirements(EVAL_TOKENS) < 0)
         throw runtime_error(CC_REQUIREMENTS_MSG);
-	if (params.size() == 1) {
+    if (params.size() > 1)
+        count = atoi(params[1].get_str().c_str());
+    if (params.size() > 2)
+        skip = atoi(params[2].get_str().c_str());
+	if (params.size() >= 1 && !params[0].get_str().empty()) {
 		tokenid = Parseuint256((char *)params[0].get_str().c_str());
 		if (tokenid == zeroid) 
 			throw runtime_error("incorrect tokenid\n");
-        return AssetOrders(tokenid, CPubKey(), 0);
+        return AssetOrders(tokenid, CPubKey(), 0, count, skip);
 	}
     else {
         // throw runtime_error("no tokenid\n");
-        return AssetOrders(zeroid, CPubKey(), 0);
+        return AssetOrders(zeroid, CPubKey(), 0, count, skip);
     }
 }
 
@@ -7605,17 +7649,23 @@ UniValue tokenorders(const UniValue& params, bool fHelp, const CPubKey& mypk)
 UniValue mytokenorders(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     uint256 tokenid;
-    if (fHelp || params.size() > 1)
-        throw runtime_error("mytokenorders [evalcode]\n"
+    int32_t count = 0, skip = 0;
+    if (fHelp || params.size() > 3)
+        throw runtime_error("mytokenorders [evalcode] [count] [skip]\n"
                             "returns all the token orders for mypubkey\n"
-                            "if evalcode is set then returns mypubkey token orders for non-fungible tokens with this evalcode\n" "\n");
+                            "if evalcode is set then returns mypubkey token orders for non-fungible tokens with this evalcode\n"
+                            "if count is set returns no more than count orders after skipping the first skip orders\n" "\n");
     if (ensure_CCrequirements(EVAL_ASSETS) < 0 || ensure_CCrequirements(EVAL_TOKENS) < 0)
         throw runtime_error(CC_REQUIREMENTS_MSG);
     uint8_t additionalEvalCode = 0;
-    if (params.size() == 1)
+    if (params.size() >= 1)
         additionalEvalCode = strtol(params[0].get_str().c_str(), NULL, 0);  // supports also 0xEE-like values
+    if (params.size() > 1)
+        count = atoi(params[1].get_str().c_str());
+    if (params.size() > 2)
+        skip = atoi(params[2].get_str().c_str());
 
-    return AssetOrders(zeroid, Mypubkey(), additionalEvalCode);
+    return AssetOrders(zeroid, Mypubkey(), additionalEvalCode, count, skip);
 }
 
 UniValue tokenbalance(const UniValue& params, bool fHelp, const CPubKey& mypk)
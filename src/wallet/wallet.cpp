@@ -912,6 +912,32 @@ bool CWallet::IsSaplingSpent(const uint256& nullifier) const {
     return false;
 }
 
+bool CWallet::IsSproutSpentBeyondWitnessCache(const uint256& nullifier) const {
+    pair<TxNullifiers::const_iterator, TxNullifiers::const_iterator> range;
+    range = mapTxSproutNullifiers.equal_range(nullifier);
+
+    for (TxNullifiers::const_iterator it = range.first; it != range.second; ++it) {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end() && mit->second.GetDepthInMainChain() > (int)WITNESS_CACHE_SIZE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CWallet::IsSaplingSpentBeyondWitnessCache(const uint256& nullifier) const {
+    pair<TxNullifiers::const_iterator, TxNullifiers::const_iterator> range;
+    range = mapTxSaplingNullifiers.equal_range(nullifier);
+
+    for (TxNullifiers::const_iterator it = range.first; it != range.second; ++it) {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end() && mit->second.GetDepthInMainChain() > (int)WITNESS_CACHE_SIZE) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void CWallet::AddToTransparentSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(make_pair(outpoint, wtxid));
@@ -1003,22 +1029,81 @@ void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nW
     }
 }
 
-template<typename NoteDataMap>
-void AppendNoteCommitment(NoteDataMap& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const uint256& note_commitment)
+/**
+ * The note witnesses a block has to advance in one shielded pool, each with
+ * the index of the first of the block's commitments it still lacks. Every
+ * witness gets all of them in one pass once the block has been walked, and
+ * large batches are spread over one thread per core.
+ */
+template<typename NoteData>
+class CNoteWitnessBatch
 {
-    for (auto& item : noteDataMap) {
-        auto* nd = &(item.second);
-        if (nd->witnessHeight < indexHeight && nd->witnesses.size() > 0) {
+private:
+    std::vector<std::pair<NoteData*, size_t>> vWitnesses;
+    std::vector<std::pair<NoteData*, size_t>> vNewWitnesses;
+    std::vector<uint256> vCommitments;
+
+public:
+    // Notes witnessed before the block, after CopyPreviousWitnesses
+    template<typename NoteDataMap>
+    void Track(NoteDataMap& noteDataMap, int indexHeight)
+    {
+        for (auto& item : noteDataMap) {
+            auto* nd = &(item.second);
+            if (nd->witnessHeight < indexHeight && nd->witnesses.size() > 0) {
+                vWitnesses.push_back(std::make_pair(nd, 0));
+            }
+        }
+    }
+
+    void AddCommitment(const uint256& note_commitment)
+    {
+        vCommitments.push_back(note_commitment);
+    }
+
+    // A note of the block, witnessed up to the last commitment added
+    void TrackNew(NoteData* nd)
+    {
+        vNewWitnesses.push_back(std::make_pair(nd, vCommitments.size()));
+    }
+
+    void Apply(int64_t nWitnessCacheSize)
+    {
+        // A note witnessed again in the block (see WitnessNoteIfMine) only
+        // needs the commitments after its new witness
+        if (!vNewWitnesses.empty()) {
+            std::set<NoteData*> setNew;
+            for (const auto& w : vNewWitnesses) {
+                setNew.insert(w.first);
+            }
+            for (const auto& w : vWitnesses) {
+                if (!setNew.count(w.first)) {
+                    vNewWitnesses.push_back(w);
+                }
+            }
+            vWitnesses.swap(vNewWitnesses);
+        }
+
+        for (const auto& w : vWitnesses) {
             // Check the validity of the cache
             // See comment in CopyPreviousWitnesses about validity.
-            assert(nWitnessCacheSize >= nd->witnesses.size());
-            nd->witnesses.front().append(note_commitment);
+            assert(nWitnessCacheSize >= w.first->witnesses.size());
         }
+
+        // Below a few hundred appends starting threads costs more than it saves
+        size_t nAppends = vWitnesses.size() * vCommitments.size();
+        size_t nThreads = nAppends < 256 ? 1 : std::max(GetNumCores(), 1);
+        ParallelFor(vWitnesses.size(), nThreads, [this](size_t i) {
+            auto& witness = vWitnesses[i].first->witnesses.front();
+            for (size_t j = vWitnesses[i].second; j < vCommitments.size(); j++) {
+                witness.append(vCommitments[j]);
+            }
+        });
     }
-}
+};
 
 template<typename OutPoint, typename NoteData, typename Witness>
-void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const OutPoint& key, const Witness& witness)
+NoteData* WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeight, int64_t nWitnessCacheSize, const OutPoint& key, const Witness& witness)
 {
     if (noteDataMap.count(key) && noteDataMap[key].witnessHeight < indexHeight) {
         auto* nd = &(noteDataMap[key]);
@@ -1044,7 +1129,9 @@ void WitnessNoteIfMine(std::map<OutPoint, NoteData>& noteDataMap, int indexHeigh
         nd->witnessHeight = indexHeight - 1;
         // Check the validity of the cache
         assert(nWitnessCacheSize >= nd->witnesses.size());
+        return nd;
     }
+    return nullptr;
 }
 
 
@@ -1068,9 +1155,29 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                                      SaplingMerkleTree& saplingTree)
 {
     LOCK(cs_wallet);
+    // Drop the witnesses of notes spent beyond the reach of a reorg, which
+    // leaves the block to advance those of notes that can still be spent.
+    // Their heights are kept up to date like those of any other note.
+    CNoteWitnessBatch<SproutNoteData> sproutBatch;
+    CNoteWitnessBatch<SaplingNoteData> saplingBatch;
     for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-       ::CopyPreviousWitnesses(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
-       ::CopyPreviousWitnesses(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize);
+        for (mapSproutNoteData_t::value_type& item : wtxItem.second.mapSproutNoteData) {
+            auto* nd = &(item.second);
+            if (nd->witnesses.size() > 0 && nd->nullifier && IsSproutSpentBeyondWitnessCache(*nd->nullifier)) {
+                nd->witnesses.clear();
+            }
+        }
+        for (mapSaplingNoteData_t::value_type& item : wtxItem.second.mapSaplingNoteData) {
+            auto* nd = &(item.second);
+            if (nd->witnesses.size() > 0 && nd->nullifier && IsSaplingSpentBeyondWitnessCache(*nd->nullifier)) {
+                nd->witnesses.clear();
+            }
+        }
+
+        ::CopyPreviousWitnesses(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
+        ::CopyPreviousWitnesses(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize);
+        sproutBatch.Track(wtxItem.second.mapSproutNoteData, pindex->GetHeight());
+        saplingBatch.Track(wtxItem.second.mapSaplingNoteData, pindex->GetHeight());
     }
 
     if (nWitnessCacheSize < WITNESS_CACHE_SIZE) {
@@ -1093,16 +1200,15 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
             for (uint8_t j = 0; j < jsdesc.commitments.size(); j++) {
                 const uint256& note_commitment = jsdesc.commitments[j];
                 sproutTree.append(note_commitment);
-
-                // Increment existing witnesses
-                for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                    ::AppendNoteCommitment(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, note_commitment);
-                }
+                sproutBatch.AddCommitment(note_commitment);
 
                 // If this is our note, witness it
                 if (txIsOurs) {
                     JSOutPoint jsoutpt {hash, i, j};
-                    ::WitnessNoteIfMine(mapWallet[hash].mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, jsoutpt, sproutTree.witness());
+                    SproutNoteData* nd = ::WitnessNoteIfMine(mapWallet[hash].mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize, jsoutpt, sproutTree.witness());
+                    if (nd) {
+                        sproutBatch.TrackNew(nd);
+                    }
                 }
             }
         }
@@ -1110,20 +1216,23 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         for (uint32_t i = 0; i < tx.vShieldedOutput.size(); i++) {
             const uint256& note_commitment = tx.vShieldedOutput[i].cm;
             saplingTree.append(note_commitment);
-
-            // Increment existing witnesses
-            for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
-                ::AppendNoteCommitment(wtxItem.second.mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, note_commitment);
-            }
+            saplingBatch.AddCommitment(note_commitment);
 
             // If this is our note, witness it
             if (txIsOurs) {
                 SaplingOutPoint outPoint {hash, i};
-                ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, outPoint, saplingTree.witness());
+                SaplingNoteData* nd = ::WitnessNoteIfMine(mapWallet[hash].mapSaplingNoteData, pindex->GetHeight(), nWitnessCacheSize, outPoint, saplingTree.witness());
+                if (nd) {
+                    saplingBatch.TrackNew(nd);
+                }
             }
         }
     }
 
+    // Increment existing witnesses
+    sproutBatch.Apply(nWitnessCacheSize);
+    saplingBatch.Apply(nWitnessCacheSize);
+
     // Update witness heights
     for (std::pair<const uint256, CWalletTx>& wtxItem : mapWallet) {
         ::UpdateWitnessHeights(wtxItem.second.mapSproutNoteData, pindex->GetHeight(), nWitnessCacheSize);
@@ -999,6 +999,13 @@ public:
     bool IsSpent(const uint256& hash, unsigned int n) const;
     bool IsSproutSpent(const uint256& nullifier) const;
     bool IsSaplingSpent(const uint256& nullifier) const;
+    /**
+     * Whether a wallet transaction more than WITNESS_CACHE_SIZE blocks deep
+     * spends the nullifier. No reorg the witness cache can undo reaches that
+     * spend, so the note's witnesses are never needed again.
+     */
+    bool IsSproutSpentBeyondWitnessCache(const uint256& nullifier) const;
+    bool IsSaplingSpentBeyondWitnessCache(const uint256& nullifier) const;
 
     bool IsLockedCoin(uint256 hash, unsigned int n) const;
     void LockCoin(COutPoint& output);
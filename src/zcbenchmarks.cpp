@@ -22,6 +22,7 @@
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
+#include "transaction_builder.h"
 #include "txdb.h"
 #include "utiltest.h"
 #include "wallet/wallet.h"
@@ -354,6 +355,62 @@ double benchmark_increment_note_witnesses(size_t nTxs)
     return timer_stop(tv_start);
 }
 
+// Connect a block with nOutputs Sapling outputs to a wallet of nTxs
+// transactions, one in ten of which holds a Sapling note of ours
+double benchmark_increment_sapling_note_witnesses(size_t nTxs, size_t nOutputs)
+{
+    CWallet wallet;
+    SproutMerkleTree sproutTree;
+    SaplingMerkleTree saplingTree;
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto address = sk.default_address();
+    auto ivk = sk.full_viewing_key().in_viewing_key();
+    auto consensusParams = Params().GetConsensus();
+    int nHeight = consensusParams.vUpgrades[Consensus::UPGRADE_SAPLING].nActivationHeight;
+
+    // Witnessing the notes through blocks would take time quadratic in their
+    // number, so each one is witnessed in a tree of its own. Only the cost of
+    // appending to the witnesses is measured.
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx = CreateNewContextualCMutableTransaction(consensusParams, nHeight);
+        mtx.nLockTime = i;
+        mapSaplingNoteData_t noteData;
+        if (i % 10 == 0) {
+            OutputDescription odesc;
+            odesc.cm = SaplingNote(address, COIN).cm().get();
+            mtx.vShieldedOutput.push_back(odesc);
+
+            SaplingMerkleTree tree;
+            tree.append(odesc.cm);
+            SaplingNoteData nd {ivk};
+            nd.witnesses.push_front(tree.witness());
+            nd.witnessHeight = 1;
+            noteData[SaplingOutPoint(mtx.GetHash(), 0)] = nd;
+        }
+        CWalletTx wtx {&wallet, mtx};
+        wtx.SetSaplingNoteData(noteData);
+        wallet.AddToWallet(wtx, true, NULL);
+    }
+    wallet.nWitnessCacheSize = 1;
+
+    CMutableTransaction mtx = CreateNewContextualCMutableTransaction(consensusParams, nHeight);
+    for (size_t i = 0; i < nOutputs; i++) {
+        OutputDescription odesc;
+        odesc.cm = SaplingNote(address, COIN).cm().get();
+        mtx.vShieldedOutput.push_back(odesc);
+    }
+    CBlock block;
+    block.vtx.push_back(mtx);
+    CBlockIndex index(block);
+    index.SetHeight(2);
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    wallet.ChainTip(&index, &block, sproutTree, saplingTree, true);
+    return timer_stop(tv_start);
+}
+
 // Fake the input of a given block
 class FakeCoinsViewDB : public CCoinsViewDB {
     uint256 hash;
@@ -567,6 +624,51 @@ double benchmark_create_sapling_output()
     return t;
 }
 
+// Build a transaction spending nSpends Sapling notes to one output and change,
+// the way z_sendmany and z_mergetoaddress do through TransactionBuilder, with
+// the descriptions prepared on nThreads threads. Running it with 1 and with
+// more threads compares the serial and the parallel build.
+double benchmark_create_sapling_transaction(size_t nSpends, size_t nThreads)
+{
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto address = sk.default_address();
+    auto consensusParams = Params().GetConsensus();
+    int nHeight = consensusParams.vUpgrades[Consensus::UPGRADE_SAPLING].nActivationHeight;
+
+    std::vector<SaplingNote> notes;
+    std::vector<SaplingWitness> witnesses;
+    SaplingMerkleTree tree;
+    for (size_t i = 0; i < nSpends; i++) {
+        SaplingNote note(address, COIN);
+        auto cm = note.cm().get();
+        tree.append(cm);
+        for (auto& witness : witnesses) {
+            witness.append(cm);
+        }
+        notes.push_back(note);
+        witnesses.push_back(tree.witness());
+    }
+    auto anchor = tree.root();
+
+    TransactionBuilder builder(consensusParams, nHeight);
+    builder.SetFee(10000);
+    builder.SetThreads(nThreads);
+    for (size_t i = 0; i < nSpends; i++) {
+        builder.AddSaplingSpend(expsk, notes[i], anchor, witnesses[i]);
+    }
+    builder.AddSaplingOutput(expsk.full_viewing_key().ovk, address, COIN / 2);
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    auto maybe_tx = builder.Build();
+    double t = timer_stop(tv_start);
+    if (!maybe_tx) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "TransactionBuilder::Build() failed");
+    }
+    return t;
+}
+
 // Verify Sapling spend from testnet
 // txid: abbd823cbd3d4e3b52023599d81a96b74817e95ce5bb58354f979156bd22ecc8
 // position: 0
@@ -630,3 +732,56 @@ double benchmark_verify_sapling_output()
     }
     return timer_stop(tv_start);
 }
+
+// Look up whether 1000 outpoints are spent in a mempool of nTxs
+// transactions, half of them spent. fScan uses the linear walk over every
+// input of every pool transaction that myIsutxo_spentinmempool used to do.
+double benchmark_mempool_spent_lookup(size_t nTxs, bool fScan)
+{
+    CTxMemPool pool(CFeeRate(0));
+    std::vector<COutPoint> queries;
+    size_t nStep = std::max<size_t>(nTxs / 500, 1);
+    for (size_t i = 0; i < nTxs; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(2);
+        mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        mtx.vin[1].prevout = COutPoint(GetRandHash(), 1);
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = 1000;
+        CTransaction tx(mtx);
+        pool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 0, 0, 0.0, 1, true, false, 0), false);
+        if (i % nStep == 0) {
+            queries.push_back(tx.vin[1].prevout);
+            queries.push_back(COutPoint(GetRandHash(), 0));
+        }
+    }
+
+    size_t nSpent = 0;
+    uint256 spenttxid;
+    int32_t spentvini;
+    struct timeval tv_start;
+    timer_start(tv_start);
+    if (fScan) {
+        LOCK(pool.cs);
+        for (const COutPoint& outpoint : queries) {
+            bool fFound = false;
+            for (const CTxMemPoolEntry& e : pool.mapTx) {
+                for (const CTxIn& txin : e.GetTx().vin) {
+                    if (txin.prevout == outpoint) {
+                        fFound = true;
+                        break;
+                    }
+                }
+                if (fFound)
+                    break;
+            }
+            nSpent += fFound;
+        }
+    } else {
+        for (const COutPoint& outpoint : queries)
+            nSpent += pool.getSpender(outpoint, spenttxid, spentvini);
+    }
+    double t = timer_stop(tv_start);
+    assert(nSpent == queries.size() / 2);
+    return t;
+}
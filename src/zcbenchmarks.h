@@ -15,13 +15,16 @@ extern double benchmark_verify_equihash();
 extern double benchmark_large_tx(size_t nInputs);
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
 extern double benchmark_increment_note_witnesses(size_t nTxs);
+extern double benchmark_increment_sapling_note_witnesses(size_t nTxs, size_t nOutputs);
 extern double benchmark_connectblock_slow();
 extern double benchmark_sendtoaddress(CAmount amount);
 extern double benchmark_loadwallet();
 extern double benchmark_listunspent();
 extern double benchmark_create_sapling_spend();
 extern double benchmark_create_sapling_output();
+extern double benchmark_create_sapling_transaction(size_t nSpends, size_t nThreads);
 extern double benchmark_verify_sapling_spend();
 extern double benchmark_verify_sapling_output();
+extern double benchmark_mempool_spent_lookup(size_t nTxs, bool fScan);
 
 #endif